@@ -0,0 +1,499 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+#include "dijkstra_router.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph{
+    // Contraction Hierarchies engine. Vertices are contracted one by one in the order of their
+    // ranks, and a shortcut is added whenever the contracted vertex lies on the only shortest
+    // path between two of its neighbours. Queries run a bidirectional search that only goes
+    // up the hierarchy and then unpack shortcuts back into the edges of the original graph.
+    template <typename Weight>
+    class ContractionHierarchyRouter final : public RouterBase<Weight>{
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+    public:
+        using RouteInfo = typename RouterBase<Weight>::RouteInfo;
+
+        // Hierarchy edge ids below graph.GetEdgeCount() are the original edges,
+        // shortcut i has hierarchy edge id graph.GetEdgeCount() + i.
+        struct Shortcut{
+            VertexId from;
+            VertexId to;
+            Weight weight;
+            EdgeId first_edge;
+            EdgeId second_edge;
+        };
+
+        struct Hierarchy{
+            std::vector<size_t> ranks;
+            std::vector<Shortcut> shortcuts;
+        };
+
+        explicit ContractionHierarchyRouter(const Graph& graph);
+        ContractionHierarchyRouter(const Graph& graph, Hierarchy&& hierarchy);
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        // Many-to-many search with buckets: one upward search from every target leaves its weight
+        // in the vertices it settles, one upward search from every source scans those vertices.
+        std::vector<std::optional<Weight>> GetRouteWeights(const std::vector<VertexId>& sources,
+            const std::vector<VertexId>& targets) const override;
+        const Hierarchy& GetHierarchy() const;
+
+    private:
+        struct HierarchyEdge{
+            VertexId to;
+            Weight weight;
+            EdgeId id;
+        };
+        using HierarchyEdges = std::vector<std::vector<HierarchyEdge>>;
+
+        struct ContractionState{
+            explicit ContractionState(size_t vertex_count)
+                : out_edges(vertex_count)
+                , in_edges(vertex_count)
+                , contracted(vertex_count, false)
+                , deleted_neighbours(vertex_count, 0)
+                , witness_space(vertex_count)
+            {}
+            std::vector<std::vector<EdgeId>> out_edges;
+            std::vector<std::vector<EdgeId>> in_edges;
+            std::vector<bool> contracted;
+            std::vector<int> deleted_neighbours;
+            SearchSpace<Weight> witness_space;
+        };
+
+        VertexId GetEdgeFrom(EdgeId edge_id) const{
+            return edge_id < graph_.GetEdgeCount() ? graph_.GetEdge(edge_id).from
+                : hierarchy_.shortcuts[edge_id - graph_.GetEdgeCount()].from;
+        }
+        VertexId GetEdgeTo(EdgeId edge_id) const{
+            return edge_id < graph_.GetEdgeCount() ? graph_.GetEdge(edge_id).to
+                : hierarchy_.shortcuts[edge_id - graph_.GetEdgeCount()].to;
+        }
+        Weight GetEdgeWeight(EdgeId edge_id) const{
+            return edge_id < graph_.GetEdgeCount() ? graph_.GetEdge(edge_id).weight
+                : hierarchy_.shortcuts[edge_id - graph_.GetEdgeCount()].weight;
+        }
+
+        void Contract();
+        void AddShortcut(ContractionState& state, const Shortcut& shortcut);
+        void DetachVertex(ContractionState& state, VertexId vertex);
+        void RunWitnessSearch(ContractionState& state, VertexId source, VertexId excluded, Weight max_weight) const;
+        int ProcessVertex(ContractionState& state, VertexId vertex, bool add_shortcuts);
+        int GetPriority(ContractionState& state, VertexId vertex);
+        void BuildSearchGraph();
+        void Step(SearchSpace<Weight>& space, const HierarchyEdges& edges, const SearchSpace<Weight>& other_space,
+            std::optional<Weight>& best_weight, VertexId& meeting_vertex) const;
+        void UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const;
+        // Settles everything reachable from start by the edges, without a target.
+        void SearchUpward(SearchSpace<Weight>& space, const HierarchyEdges& edges, VertexId start) const;
+
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr size_t WITNESS_SEARCH_LIMIT = 50;
+        const Graph& graph_;
+        Hierarchy hierarchy_;
+        HierarchyEdges upward_edges_;
+        HierarchyEdges downward_edges_;
+        mutable SearchSpacePool<Weight> search_spaces_;
+    };
+
+    template <typename Weight>
+    ContractionHierarchyRouter<Weight>::ContractionHierarchyRouter(const Graph& graph)
+        : graph_(graph)
+        , search_spaces_(graph.GetVertexCount())
+    {
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id){
+            if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT){
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+        Contract();
+        BuildSearchGraph();
+    }
+
+    template <typename Weight>
+    ContractionHierarchyRouter<Weight>::ContractionHierarchyRouter(const Graph& graph, Hierarchy&& hierarchy)
+        : graph_(graph)
+        , hierarchy_(std::move(hierarchy))
+        , search_spaces_(graph.GetVertexCount())
+    {
+        if (hierarchy_.ranks.size() != graph.GetVertexCount()){
+            throw std::invalid_argument("Contraction hierarchy does not match the graph");
+        }
+        const EdgeId edge_count = graph.GetEdgeCount() + hierarchy_.shortcuts.size();
+        for (const Shortcut& shortcut : hierarchy_.shortcuts){
+            if (shortcut.from >= graph.GetVertexCount() || shortcut.to >= graph.GetVertexCount()
+                || shortcut.first_edge >= edge_count || shortcut.second_edge >= edge_count){
+                throw std::invalid_argument("Contraction hierarchy does not match the graph");
+            }
+        }
+        BuildSearchGraph();
+    }
+
+    template <typename Weight>
+    const typename ContractionHierarchyRouter<Weight>::Hierarchy& ContractionHierarchyRouter<Weight>::GetHierarchy() const{
+        return hierarchy_;
+    }
+
+    template <typename Weight>
+    void ContractionHierarchyRouter<Weight>::RunWitnessSearch(ContractionState& state, VertexId source,
+        VertexId excluded, Weight max_weight) const{
+        SearchSpace<Weight>& space = state.witness_space;
+        space.Reset();
+        space.Reach(source, ZERO_WEIGHT, NO_EDGE);
+        size_t settled = 0;
+        while (const auto item = space.PopMin()){
+            if (max_weight < item->weight || ++settled > WITNESS_SEARCH_LIMIT){
+                break;
+            }
+            for (const EdgeId edge_id : state.out_edges[item->vertex]){
+                const VertexId to = GetEdgeTo(edge_id);
+                if (to == excluded || state.contracted[to]){
+                    continue;
+                }
+                const Weight candidate_weight = item->weight + GetEdgeWeight(edge_id);
+                if (!space.reached[to] || candidate_weight < space.weights[to]){
+                    space.Reach(to, candidate_weight, edge_id);
+                }
+            }
+        }
+    }
+
+    // Counts (or adds) the shortcuts needed to contract the vertex and returns their number.
+    template <typename Weight>
+    int ContractionHierarchyRouter<Weight>::ProcessVertex(ContractionState& state, VertexId vertex, bool add_shortcuts){
+        int shortcuts_count = 0;
+        for (const EdgeId in_edge : state.in_edges[vertex]){
+            const VertexId from = GetEdgeFrom(in_edge);
+            if (from == vertex || state.contracted[from]){
+                continue;
+            }
+            const Weight in_weight = GetEdgeWeight(in_edge);
+            std::optional<Weight> max_weight;
+            for (const EdgeId out_edge : state.out_edges[vertex]){
+                const VertexId to = GetEdgeTo(out_edge);
+                if (to == vertex || to == from || state.contracted[to]){
+                    continue;
+                }
+                const Weight candidate_weight = in_weight + GetEdgeWeight(out_edge);
+                if (!max_weight || *max_weight < candidate_weight){
+                    max_weight = candidate_weight;
+                }
+            }
+            if (!max_weight){
+                continue;
+            }
+            RunWitnessSearch(state, from, vertex, *max_weight);
+            for (const EdgeId out_edge : state.out_edges[vertex]){
+                const VertexId to = GetEdgeTo(out_edge);
+                if (to == vertex || to == from || state.contracted[to]){
+                    continue;
+                }
+                const Weight candidate_weight = in_weight + GetEdgeWeight(out_edge);
+                const SearchSpace<Weight>& space = state.witness_space;
+                if (space.reached[to] && !(candidate_weight < space.weights[to])){
+                    continue;
+                }
+                ++shortcuts_count;
+                if (add_shortcuts){
+                    AddShortcut(state, { from, to, candidate_weight, in_edge, out_edge });
+                }
+            }
+        }
+        return shortcuts_count;
+    }
+
+    // Keeps at most one edge between two vertices: a heavier parallel edge is never on a shortest path.
+    template <typename Weight>
+    void ContractionHierarchyRouter<Weight>::AddShortcut(ContractionState& state, const Shortcut& shortcut){
+        auto& out_edges = state.out_edges[shortcut.from];
+        const auto parallel_it = std::find_if(out_edges.begin(), out_edges.end(), [this, &shortcut](EdgeId edge_id){
+            return GetEdgeTo(edge_id) == shortcut.to;
+        });
+        if (parallel_it != out_edges.end()){
+            if (!(shortcut.weight < GetEdgeWeight(*parallel_it))){
+                return;
+            }
+            auto& in_edges = state.in_edges[shortcut.to];
+            in_edges.erase(std::remove(in_edges.begin(), in_edges.end(), *parallel_it), in_edges.end());
+            out_edges.erase(parallel_it);
+        }
+        const EdgeId shortcut_id = graph_.GetEdgeCount() + hierarchy_.shortcuts.size();
+        hierarchy_.shortcuts.push_back(shortcut);
+        out_edges.push_back(shortcut_id);
+        state.in_edges[shortcut.to].push_back(shortcut_id);
+    }
+
+    template <typename Weight>
+    void ContractionHierarchyRouter<Weight>::DetachVertex(ContractionState& state, VertexId vertex){
+        for (const EdgeId edge_id : state.in_edges[vertex]){
+            const VertexId from = GetEdgeFrom(edge_id);
+            if (from == vertex){
+                continue;
+            }
+            auto& out_edges = state.out_edges[from];
+            out_edges.erase(std::remove(out_edges.begin(), out_edges.end(), edge_id), out_edges.end());
+            ++state.deleted_neighbours[from];
+        }
+        for (const EdgeId edge_id : state.out_edges[vertex]){
+            const VertexId to = GetEdgeTo(edge_id);
+            if (to == vertex){
+                continue;
+            }
+            auto& in_edges = state.in_edges[to];
+            in_edges.erase(std::remove(in_edges.begin(), in_edges.end(), edge_id), in_edges.end());
+            ++state.deleted_neighbours[to];
+        }
+        state.in_edges[vertex].clear();
+        state.out_edges[vertex].clear();
+    }
+
+    template <typename Weight>
+    int ContractionHierarchyRouter<Weight>::GetPriority(ContractionState& state, VertexId vertex){
+        int removed_edges = 0;
+        for (const EdgeId edge_id : state.in_edges[vertex]){
+            removed_edges += state.contracted[GetEdgeFrom(edge_id)] ? 0 : 1;
+        }
+        for (const EdgeId edge_id : state.out_edges[vertex]){
+            removed_edges += state.contracted[GetEdgeTo(edge_id)] ? 0 : 1;
+        }
+        return ProcessVertex(state, vertex, false) - removed_edges + state.deleted_neighbours[vertex];
+    }
+
+    template <typename Weight>
+    void ContractionHierarchyRouter<Weight>::Contract(){
+        const size_t vertex_count = graph_.GetVertexCount();
+        ContractionState state(vertex_count);
+        std::vector<EdgeId> edge_ids(graph_.GetEdgeCount());
+        for (EdgeId edge_id = 0; edge_id < edge_ids.size(); ++edge_id){
+            edge_ids[edge_id] = edge_id;
+        }
+        std::sort(edge_ids.begin(), edge_ids.end(), [this](EdgeId lhs, EdgeId rhs){
+            const auto& lhs_edge = graph_.GetEdge(lhs);
+            const auto& rhs_edge = graph_.GetEdge(rhs);
+            if (lhs_edge.from != rhs_edge.from || lhs_edge.to != rhs_edge.to){
+                return std::pair{ lhs_edge.from, lhs_edge.to } < std::pair{ rhs_edge.from, rhs_edge.to };
+            }
+            return lhs_edge.weight < rhs_edge.weight || (!(rhs_edge.weight < lhs_edge.weight) && lhs < rhs);
+        });
+        for (size_t i = 0; i < edge_ids.size(); ++i){
+            const auto& edge = graph_.GetEdge(edge_ids[i]);
+            if (edge.from == edge.to || (i > 0 && graph_.GetEdge(edge_ids[i - 1]).from == edge.from
+                && graph_.GetEdge(edge_ids[i - 1]).to == edge.to)){
+                continue;
+            }
+            state.out_edges[edge.from].push_back(edge_ids[i]);
+            state.in_edges[edge.to].push_back(edge_ids[i]);
+        }
+
+        using QueueItem = std::pair<int, VertexId>;
+        std::vector<QueueItem> queue;
+        queue.reserve(vertex_count);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex){
+            queue.push_back({ GetPriority(state, vertex), vertex });
+        }
+        std::make_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+
+        hierarchy_.ranks.assign(vertex_count, 0);
+        size_t rank = 0;
+        while (!queue.empty()){
+            std::pop_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+            const VertexId vertex = queue.back().second;
+            queue.pop_back();
+            // Lazy update: the priority may have grown since the vertex was queued
+            const int priority = GetPriority(state, vertex);
+            if (!queue.empty() && queue.front().first < priority){
+                queue.push_back({ priority, vertex });
+                std::push_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+                continue;
+            }
+            ProcessVertex(state, vertex, true);
+            DetachVertex(state, vertex);
+            state.contracted[vertex] = true;
+            hierarchy_.ranks[vertex] = rank++;
+        }
+    }
+
+    template <typename Weight>
+    void ContractionHierarchyRouter<Weight>::BuildSearchGraph(){
+        const size_t vertex_count = graph_.GetVertexCount();
+        upward_edges_.assign(vertex_count, {});
+        downward_edges_.assign(vertex_count, {});
+        const EdgeId edge_count = graph_.GetEdgeCount() + hierarchy_.shortcuts.size();
+        for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id){
+            const VertexId from = GetEdgeFrom(edge_id);
+            const VertexId to = GetEdgeTo(edge_id);
+            if (hierarchy_.ranks[from] < hierarchy_.ranks[to]){
+                upward_edges_[from].push_back({ to, GetEdgeWeight(edge_id), edge_id });
+            }
+            else if (hierarchy_.ranks[to] < hierarchy_.ranks[from]){
+                downward_edges_[to].push_back({ from, GetEdgeWeight(edge_id), edge_id });
+            }
+        }
+        for (auto* edges : { &upward_edges_, &downward_edges_ }){
+            for (auto& vertex_edges : *edges){
+                std::sort(vertex_edges.begin(), vertex_edges.end(), [](const HierarchyEdge& lhs, const HierarchyEdge& rhs){
+                    if (lhs.to != rhs.to){
+                        return lhs.to < rhs.to;
+                    }
+                    return lhs.weight < rhs.weight || (!(rhs.weight < lhs.weight) && lhs.id < rhs.id);
+                });
+                vertex_edges.erase(std::unique(vertex_edges.begin(), vertex_edges.end(), [](const HierarchyEdge& lhs, const HierarchyEdge& rhs){
+                    return lhs.to == rhs.to;
+                }), vertex_edges.end());
+            }
+        }
+    }
+
+    template <typename Weight>
+    void ContractionHierarchyRouter<Weight>::Step(SearchSpace<Weight>& space, const HierarchyEdges& edges,
+        const SearchSpace<Weight>& other_space, std::optional<Weight>& best_weight, VertexId& meeting_vertex) const{
+        const auto item = space.PopMin();
+        if (!item){
+            return;
+        }
+        if (other_space.reached[item->vertex]){
+            const Weight candidate_weight = item->weight + other_space.weights[item->vertex];
+            if (!best_weight || candidate_weight < *best_weight){
+                best_weight = candidate_weight;
+                meeting_vertex = item->vertex;
+            }
+        }
+        for (const HierarchyEdge& edge : edges[item->vertex]){
+            const Weight candidate_weight = item->weight + edge.weight;
+            if (!space.reached[edge.to] || candidate_weight < space.weights[edge.to]){
+                space.Reach(edge.to, candidate_weight, edge.id);
+            }
+        }
+    }
+
+    template <typename Weight>
+    void ContractionHierarchyRouter<Weight>::UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const{
+        std::vector<EdgeId> stack{ edge_id };
+        while (!stack.empty()){
+            const EdgeId current = stack.back();
+            stack.pop_back();
+            if (current < graph_.GetEdgeCount()){
+                edges.push_back(current);
+            }
+            else{
+                const Shortcut& shortcut = hierarchy_.shortcuts[current - graph_.GetEdgeCount()];
+                stack.push_back(shortcut.second_edge);
+                stack.push_back(shortcut.first_edge);
+            }
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename ContractionHierarchyRouter<Weight>::RouteInfo> ContractionHierarchyRouter<Weight>::BuildRoute(
+        VertexId from, VertexId to) const{
+        if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()){
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const auto forward_lease = search_spaces_.Acquire();
+        const auto backward_lease = search_spaces_.Acquire();
+        SearchSpace<Weight>& forward = *forward_lease;
+        SearchSpace<Weight>& backward = *backward_lease;
+        forward.Reset();
+        backward.Reset();
+        forward.Reach(from, ZERO_WEIGHT, NO_EDGE);
+        backward.Reach(to, ZERO_WEIGHT, NO_EDGE);
+
+        std::optional<Weight> best_weight;
+        VertexId meeting_vertex = from;
+        while (true){
+            const bool forward_active = !forward.heap.empty() && (!best_weight || forward.Top().weight < *best_weight);
+            const bool backward_active = !backward.heap.empty() && (!best_weight || backward.Top().weight < *best_weight);
+            if (!forward_active && !backward_active){
+                break;
+            }
+            if (forward_active && (!backward_active || !(backward.Top().weight < forward.Top().weight))){
+                Step(forward, upward_edges_, backward, best_weight, meeting_vertex);
+            }
+            else{
+                Step(backward, downward_edges_, forward, best_weight, meeting_vertex);
+            }
+        }
+        if (!best_weight){
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> hierarchy_edges;
+        for (EdgeId edge_id = forward.prev_edges[meeting_vertex]; edge_id != NO_EDGE;
+            edge_id = forward.prev_edges[GetEdgeFrom(edge_id)]){
+            hierarchy_edges.push_back(edge_id);
+        }
+        std::reverse(hierarchy_edges.begin(), hierarchy_edges.end());
+        for (EdgeId edge_id = backward.prev_edges[meeting_vertex]; edge_id != NO_EDGE;
+            edge_id = backward.prev_edges[GetEdgeTo(edge_id)]){
+            hierarchy_edges.push_back(edge_id);
+        }
+
+        std::vector<EdgeId> edges;
+        for (const EdgeId edge_id : hierarchy_edges){
+            UnpackEdge(edge_id, edges);
+        }
+        return RouteInfo{ *best_weight, std::move(edges) };
+    }
+    template <typename Weight>
+    std::vector<std::optional<Weight>> ContractionHierarchyRouter<Weight>::GetRouteWeights(const std::vector<VertexId>& sources,
+        const std::vector<VertexId>& targets) const{
+        for (const auto* vertexes : { &sources, &targets }){
+            if (std::any_of(vertexes->begin(), vertexes->end(), [this](VertexId vertex){ return vertex >= graph_.GetVertexCount(); })){
+                throw std::out_of_range("Vertex id is out of range");
+            }
+        }
+        struct BucketItem{
+            size_t target_index;
+            Weight weight;
+        };
+        std::vector<std::vector<BucketItem>> buckets(graph_.GetVertexCount());
+        const auto lease = search_spaces_.Acquire();
+        SearchSpace<Weight>& space = *lease;
+        for (size_t target_index = 0; target_index < targets.size(); ++target_index){
+            SearchUpward(space, downward_edges_, targets[target_index]);
+            for (const VertexId vertex : space.touched){
+                buckets[vertex].push_back({ target_index, space.weights[vertex] });
+            }
+        }
+
+        std::vector<std::optional<Weight>> weights(sources.size() * targets.size());
+        for (size_t source_index = 0; source_index < sources.size(); ++source_index){
+            SearchUpward(space, upward_edges_, sources[source_index]);
+            std::optional<Weight>* row = weights.data() + source_index * targets.size();
+            for (const VertexId vertex : space.touched){
+                for (const BucketItem& item : buckets[vertex]){
+                    const Weight candidate_weight = space.weights[vertex] + item.weight;
+                    if (!row[item.target_index] || candidate_weight < *row[item.target_index]){
+                        row[item.target_index] = candidate_weight;
+                    }
+                }
+            }
+        }
+        return weights;
+    }
+
+    template <typename Weight>
+    void ContractionHierarchyRouter<Weight>::SearchUpward(SearchSpace<Weight>& space, const HierarchyEdges& edges,
+        VertexId start) const{
+        space.Reset();
+        space.Reach(start, ZERO_WEIGHT, NO_EDGE);
+        while (const auto item = space.PopMin()){
+            for (const HierarchyEdge& edge : edges[item->vertex]){
+                const Weight candidate_weight = item->weight + edge.weight;
+                if (!space.reached[edge.to] || candidate_weight < space.weights[edge.to]){
+                    space.Reach(edge.to, candidate_weight, edge.id);
+                }
+            }
+        }
+    }
+
+}
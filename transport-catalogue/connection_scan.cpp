@@ -0,0 +1,99 @@
+#include "connection_scan.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+using namespace std;
+namespace router{
+
+	namespace{
+		constexpr uint32_t NO_CONNECTION = numeric_limits<uint32_t>::max();
+	}
+
+	ConnectionScanRouter::ConnectionScanRouter(const transport_catalogue::TransportCatalogue& tc, double meters_per_minute){
+		stops_.resize(tc.GetAllStopsCount());
+		for (const auto* stop : tc.GetAllStopsPtr()){
+			stops_.at(stop->id) = stop;
+		}
+		for (const auto* route : tc.GetAllRoutesPtr()){
+			if (route->stops.size() < 2){
+				continue;
+			}
+			for (const double first_departure : route->departures){
+				const uint32_t trip = static_cast<uint32_t>(trip_routes_.size());
+				trip_routes_.push_back(route);
+				for (size_t i = 0; i + 1 < route->stops.size(); ++i){
+					connections_.push_back({
+						static_cast<uint32_t>(route->stops[i]->id),
+						static_cast<uint32_t>(route->stops[i + 1]->id),
+						trip,
+						static_cast<uint32_t>(i),
+						first_departure + route->distances_from_start[i] / meters_per_minute,
+						first_departure + route->distances_from_start[i + 1] / meters_per_minute });
+				}
+			}
+		}
+		// Rides of zero length go before the rides that leave their stop at the same time, and the rides
+		// of one trip that all leave at the same time keep the order of its stops.
+		sort(connections_.begin(), connections_.end(), [](const Connection& lhs, const Connection& rhs){
+			return tie(lhs.departure, lhs.arrival, lhs.trip, lhs.stop_index) < tie(rhs.departure, rhs.arrival, rhs.trip, rhs.stop_index);
+		});
+	}
+
+	optional<vector<JourneyLeg>> ConnectionScanRouter::FindJourney(const transport_catalogue::Stop* from,
+		const transport_catalogue::Stop* to, double departure_time) const{
+		if (from == nullptr || to == nullptr || from->id >= stops_.size() || to->id >= stops_.size()){
+			throw out_of_range("Unknown stop");
+		}
+		struct Ride{
+			uint32_t enter = NO_CONNECTION;
+			uint32_t exit = NO_CONNECTION;
+		};
+		vector<double> arrivals(stops_.size(), numeric_limits<double>::infinity());
+		// The connection by which the best arrival at every stop ends and the one where its trip was boarded.
+		vector<Ride> rides(stops_.size());
+		vector<uint32_t> boardings(trip_routes_.size(), NO_CONNECTION);
+		arrivals[from->id] = departure_time;
+
+		const auto first = partition_point(connections_.begin(), connections_.end(), [departure_time](const Connection& connection){
+			return connection.departure < departure_time;
+		});
+		for (auto it = first; it != connections_.end(); ++it){
+			const Connection& connection = *it;
+			if (connection.departure >= arrivals[to->id]){
+				break;
+			}
+			uint32_t& boarding = boardings[connection.trip];
+			if (boarding == NO_CONNECTION){
+				if (arrivals[connection.from_stop] > connection.departure){
+					continue;
+				}
+				boarding = static_cast<uint32_t>(it - connections_.begin());
+			}
+			if (connection.arrival < arrivals[connection.to_stop]){
+				arrivals[connection.to_stop] = connection.arrival;
+				rides[connection.to_stop] = { boarding, static_cast<uint32_t>(it - connections_.begin()) };
+			}
+		}
+		if (arrivals[to->id] == numeric_limits<double>::infinity()){
+			return nullopt;
+		}
+
+		vector<JourneyLeg> legs;
+		for (size_t stop = to->id; stop != from->id; ){
+			const Connection& enter = connections_[rides[stop].enter];
+			const Connection& exit = connections_[rides[stop].exit];
+			legs.push_back({
+				stops_[enter.from_stop],
+				trip_routes_[enter.trip]->route_name,
+				static_cast<int>(exit.stop_index - enter.stop_index + 1),
+				enter.departure,
+				exit.arrival });
+			stop = enter.from_stop;
+		}
+		reverse(legs.begin(), legs.end());
+		return legs;
+	}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "domain.h"
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+
+namespace router{
+
+	// A ride on one trip from the stop where the passenger boards.
+	struct JourneyLeg{
+		const transport_catalogue::Stop* from = nullptr;
+		// A name kept by the catalogue.
+		std::string_view route_name;
+		int span_count = 0;
+		// Minutes after midnight.
+		double departure = 0.0;
+		double arrival = 0.0;
+	};
+
+	// Earliest arrival routing over the timetables of the routes (Connection Scan Algorithm).
+	// Every trip of a route leaves its first stop at one of Route::departures and runs with the bus
+	// velocity. A ride between two neighbouring stops is a connection; all of them are kept in one
+	// array sorted by the departure, and a query is a single forward scan of its tail.
+	class ConnectionScanRouter{
+	public:
+		ConnectionScanRouter(const transport_catalogue::TransportCatalogue&, double meters_per_minute);
+		// Legs of the journey that arrives at to first, leaving from not earlier than departure_time;
+		// nullopt if no trip gets there. Concurrent calls are safe.
+		std::optional<std::vector<JourneyLeg>> FindJourney(const transport_catalogue::Stop* from,
+			const transport_catalogue::Stop* to, double departure_time) const;
+	private:
+		struct Connection{
+			std::uint32_t from_stop;
+			std::uint32_t to_stop;
+			std::uint32_t trip;
+			// The index of from_stop in the stops of the route.
+			std::uint32_t stop_index;
+			double departure;
+			double arrival;
+		};
+
+		std::vector<Connection> connections_;
+		std::vector<const transport_catalogue::Route*> trip_routes_;
+		std::vector<const transport_catalogue::Stop*> stops_;
+	};
+
+}
@@ -0,0 +1,270 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph{
+    inline constexpr EdgeId NO_EDGE = static_cast<EdgeId>(-1);
+
+    // Buffers of a single-source search. They are allocated once for the whole graph
+    // and Reset() clears only the vertices touched by the previous search.
+    template <typename Weight>
+    struct SearchSpace{
+        struct QueueItem{
+            Weight weight;
+            VertexId vertex;
+            bool operator>(const QueueItem& other) const{
+                return weight > other.weight;
+            }
+        };
+
+        explicit SearchSpace(size_t vertex_count)
+            : weights(vertex_count)
+            , prev_edges(vertex_count, NO_EDGE)
+            , reached(vertex_count, false)
+            , visited(vertex_count, false)
+        {}
+
+        void Reset(){
+            for (const VertexId vertex : touched){
+                reached[vertex] = false;
+                visited[vertex] = false;
+            }
+            touched.clear();
+            heap.clear();
+        }
+
+        void Reach(VertexId vertex, Weight weight, EdgeId prev_edge){
+            if (!reached[vertex]){
+                reached[vertex] = true;
+                touched.push_back(vertex);
+            }
+            weights[vertex] = weight;
+            prev_edges[vertex] = prev_edge;
+            heap.push_back({ weight, vertex });
+            std::push_heap(heap.begin(), heap.end(), std::greater<QueueItem>{});
+        }
+
+        const QueueItem& Top() const{
+            return heap.front();
+        }
+
+        // Returns the next unvisited vertex with the smallest weight and marks it visited.
+        std::optional<QueueItem> PopMin(){
+            while (!heap.empty()){
+                std::pop_heap(heap.begin(), heap.end(), std::greater<QueueItem>{});
+                const QueueItem item = heap.back();
+                heap.pop_back();
+                if (!visited[item.vertex]){
+                    visited[item.vertex] = true;
+                    return item;
+                }
+            }
+            return std::nullopt;
+        }
+
+        std::vector<Weight> weights;
+        std::vector<EdgeId> prev_edges;
+        std::vector<bool> reached;
+        std::vector<bool> visited;
+        std::vector<VertexId> touched;
+        std::vector<QueueItem> heap;
+    };
+
+    // Search spaces of one router shared by concurrent queries: a query takes a free one
+    // (or a new one if all are busy) and the lease gives it back when the query ends.
+    template <typename Weight>
+    class SearchSpacePool{
+    public:
+        class Lease{
+        public:
+            Lease(SearchSpacePool& pool, std::unique_ptr<SearchSpace<Weight>> space)
+                : pool_(pool), space_(std::move(space))
+            {}
+            Lease(const Lease&) = delete;
+            Lease& operator=(const Lease&) = delete;
+            ~Lease(){
+                pool_.Release(std::move(space_));
+            }
+            SearchSpace<Weight>& operator*() const{
+                return *space_;
+            }
+        private:
+            SearchSpacePool& pool_;
+            std::unique_ptr<SearchSpace<Weight>> space_;
+        };
+
+        explicit SearchSpacePool(size_t vertex_count)
+            : vertex_count_(vertex_count)
+        {}
+
+        Lease Acquire(){
+            std::unique_ptr<SearchSpace<Weight>> space;
+            {
+                std::lock_guard lock(mutex_);
+                if (!free_spaces_.empty()){
+                    space = std::move(free_spaces_.back());
+                    free_spaces_.pop_back();
+                }
+            }
+            if (!space){
+                space = std::make_unique<SearchSpace<Weight>>(vertex_count_);
+            }
+            return Lease(*this, std::move(space));
+        }
+    private:
+        void Release(std::unique_ptr<SearchSpace<Weight>> space){
+            std::lock_guard lock(mutex_);
+            free_spaces_.push_back(std::move(space));
+        }
+
+        size_t vertex_count_;
+        std::mutex mutex_;
+        std::vector<std::unique_ptr<SearchSpace<Weight>>> free_spaces_;
+    };
+
+    // Settles the vertices reachable from `from` with a weight up to max_weight, nearest first, and
+    // returns them with their weights. The search never goes past the limit.
+    template <typename Weight>
+    std::vector<std::pair<VertexId, Weight>> FindReachable(const DirectedWeightedGraph<Weight>& graph,
+        SearchSpace<Weight>& space, VertexId from, Weight max_weight){
+        if (from >= graph.GetVertexCount()){
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        std::vector<std::pair<VertexId, Weight>> reachable;
+        space.Reset();
+        space.Reach(from, Weight{}, NO_EDGE);
+        while (const auto item = space.PopMin()){
+            reachable.emplace_back(item->vertex, item->weight);
+            for (const EdgeId edge_id : graph.GetIncidentEdges(item->vertex)){
+                const auto& edge = graph.GetEdge(edge_id);
+                const Weight candidate_weight = item->weight + edge.weight;
+                if (!(max_weight < candidate_weight) && (!space.reached[edge.to] || candidate_weight < space.weights[edge.to])){
+                    space.Reach(edge.to, candidate_weight, edge_id);
+                }
+            }
+        }
+        return reachable;
+    }
+
+    // Answers every BuildRoute() with a single-source search instead of an all-pairs table.
+    // Concurrent queries use separate search spaces, so one instance can be shared between threads.
+    template <typename Weight>
+    class DijkstraRouter final : public RouterBase<Weight>{
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+    public:
+        using RouteInfo = typename RouterBase<Weight>::RouteInfo;
+
+        explicit DijkstraRouter(const Graph& graph);
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        // One search per source, which stops once every target is reached for sure.
+        std::vector<std::optional<Weight>> GetRouteWeights(const std::vector<VertexId>& sources,
+            const std::vector<VertexId>& targets) const override;
+    private:
+        static constexpr Weight ZERO_WEIGHT{};
+        const Graph& graph_;
+        mutable SearchSpacePool<Weight> search_spaces_;
+    };
+
+    template <typename Weight>
+    DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph)
+        : graph_(graph)
+        , search_spaces_(graph.GetVertexCount())
+    {
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id){
+            if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT){
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+        VertexId to) const{
+        if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()){
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const auto lease = search_spaces_.Acquire();
+        SearchSpace<Weight>& space = *lease;
+        space.Reset();
+        space.Reach(from, ZERO_WEIGHT, NO_EDGE);
+        while (const auto item = space.PopMin()){
+            if (item->vertex == to){
+                break;
+            }
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(item->vertex)){
+                const auto& edge = graph_.GetEdge(edge_id);
+                const Weight candidate_weight = item->weight + edge.weight;
+                if (!space.reached[edge.to] || candidate_weight < space.weights[edge.to]){
+                    space.Reach(edge.to, candidate_weight, edge_id);
+                }
+            }
+        }
+        if (!space.reached[to]){
+            return std::nullopt;
+        }
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = space.prev_edges[to]; edge_id != NO_EDGE; edge_id = space.prev_edges[graph_.GetEdge(edge_id).from]){
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+        return RouteInfo{ space.weights[to], std::move(edges) };
+    }
+    template <typename Weight>
+    std::vector<std::optional<Weight>> DijkstraRouter<Weight>::GetRouteWeights(const std::vector<VertexId>& sources,
+        const std::vector<VertexId>& targets) const{
+        if (targets.empty()){
+            return {};
+        }
+        std::vector<bool> is_target(graph_.GetVertexCount(), false);
+        size_t targets_count = 0;
+        for (const VertexId vertex : targets){
+            if (vertex >= graph_.GetVertexCount()){
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            if (!is_target[vertex]){
+                is_target[vertex] = true;
+                ++targets_count;
+            }
+        }
+        std::vector<std::optional<Weight>> weights;
+        weights.reserve(sources.size() * targets.size());
+        const auto lease = search_spaces_.Acquire();
+        SearchSpace<Weight>& space = *lease;
+        for (const VertexId from : sources){
+            if (from >= graph_.GetVertexCount()){
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            space.Reset();
+            space.Reach(from, ZERO_WEIGHT, NO_EDGE);
+            size_t targets_left = targets_count;
+            while (const auto item = space.PopMin()){
+                if (is_target[item->vertex] && --targets_left == 0){
+                    break;
+                }
+                for (const EdgeId edge_id : graph_.GetIncidentEdges(item->vertex)){
+                    const auto& edge = graph_.GetEdge(edge_id);
+                    const Weight candidate_weight = item->weight + edge.weight;
+                    if (!space.reached[edge.to] || candidate_weight < space.weights[edge.to]){
+                        space.Reach(edge.to, candidate_weight, edge_id);
+                    }
+                }
+            }
+            for (const VertexId to : targets){
+                weights.push_back(space.reached[to] ? std::optional<Weight>(space.weights[to]) : std::nullopt);
+            }
+        }
+        return weights;
+    }
+
+}
@@ -14,8 +14,11 @@ struct Stop{
 	Stop() = default;
 	Stop(const std::string_view stop_name, const double lat, const double lng);
 	Stop(const Stop* other_stop_ptr);
-	std::string name;
+	// Refers to the name kept by the catalogue once the stop is added to it.
+	std::string_view name;
 	geo::Coordinates coords{0,0};
+	// Dense index of the stop in the order the catalogue added it.
+	size_t id = 0;
 };
 
 
@@ -23,13 +26,14 @@ struct Route{
 	Route() = default;
 	Route(const Route* other_stop_ptr);
 
-	std::string route_name;
+	// Refers to the name kept by the catalogue once the route is added to it.
+	std::string_view route_name;
 	std::vector<const Stop*> stops;
-	size_t unique_stops_qty = 0;
-	double geo_route_length = 0;
-	size_t meters_route_length = 0;
-	double curvature = 0;
 	bool is_circular = false;
+	// Road distance from the first stop to every stop of stops, filled by TransportCatalogue::Finalize.
+	std::vector<size_t> distances_from_start;
+	// Minutes after midnight when the trips leave the first stop; empty if the route has no timetable.
+	std::vector<double> departures;
 };
 
 struct RendererData{
@@ -37,10 +41,4 @@ struct RendererData{
 	std::vector<std::string_view> stop_names;  
 	bool is_circular = false; 
 };
-class Hasher{
-public:
-	std::size_t operator()(const std::pair<const Stop*, const Stop*> pair_of_pointers) const noexcept;
-private:
-	std::hash<const void*> hasher_;
-};
 }
\ No newline at end of file
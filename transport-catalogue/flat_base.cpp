@@ -0,0 +1,107 @@
+#include "flat_base.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+using namespace std;
+namespace flat_base{
+	namespace{
+		constexpr size_t SECTION_ALIGNMENT = 8;
+
+		size_t AlignUp(size_t offset){
+			return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+		}
+	}
+
+	bool IsFlatBase(string_view contents){
+		return contents.size() >= sizeof(MAGIC) && contents.substr(0, sizeof(MAGIC)) == string_view(MAGIC, sizeof(MAGIC));
+	}
+
+	StringRef Writer::AddString(string_view value){
+		if (strings_.size() + value.size() > numeric_limits<uint32_t>::max()){
+			throw overflow_error("Names do not fit the flat base");
+		}
+		const StringRef ref{ static_cast<uint32_t>(strings_.size()), static_cast<uint32_t>(value.size()) };
+		strings_ += value;
+		return ref;
+	}
+
+	void Writer::SetSection(Section section, string bytes){
+		string& owned_bytes = owned_sections_[static_cast<size_t>(section)];
+		owned_bytes = move(bytes);
+		SetSectionView(section, owned_bytes);
+	}
+
+	void Writer::SetSectionView(Section section, string_view bytes){
+		sections_[static_cast<size_t>(section)] = bytes;
+	}
+
+	void Writer::SetVertexCount(size_t vertex_count){
+		vertex_count_ = static_cast<uint32_t>(vertex_count);
+	}
+
+	void Writer::Write(ostream& output) const{
+		Header header;
+		copy(begin(MAGIC), end(MAGIC), header.magic);
+		header.vertex_count = vertex_count_;
+		size_t offset = AlignUp(sizeof(Header));
+		for (size_t section = 0; section < sections_.size(); ++section){
+			const size_t size = section == static_cast<size_t>(Section::STRINGS) ? strings_.size() : sections_[section].size();
+			header.sections[section] = { offset, size };
+			offset = AlignUp(offset + size);
+		}
+
+		const string padding(SECTION_ALIGNMENT, '\0');
+		output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		size_t written = sizeof(header);
+		for (size_t section = 0; section < sections_.size(); ++section){
+			const string_view bytes = section == static_cast<size_t>(Section::STRINGS) ? string_view(strings_) : sections_[section];
+			output.write(padding.data(), header.sections[section].offset - written);
+			output.write(bytes.data(), bytes.size());
+			written = header.sections[section].offset + bytes.size();
+		}
+		if (!output){
+			throw runtime_error("Can't write the flat base");
+		}
+	}
+
+	View::View(shared_ptr<const io::MappedFile> file) : file_(move(file)){
+		const string_view contents = file_->GetContents();
+		if (!IsFlatBase(contents) || contents.size() < sizeof(Header)){
+			throw runtime_error("Not a flat base");
+		}
+		memcpy(&header_, contents.data(), sizeof(Header));
+		if (header_.version != VERSION || header_.sections_count != static_cast<uint32_t>(Section::COUNT)){
+			throw runtime_error("Unsupported version of the flat base");
+		}
+		for (const SectionEntry& entry : header_.sections){
+			if (entry.offset % SECTION_ALIGNMENT != 0 || entry.offset > contents.size() || entry.size > contents.size() - entry.offset){
+				throw runtime_error("Corrupted flat base: section out of the file");
+			}
+		}
+		if (reinterpret_cast<uintptr_t>(contents.data()) % SECTION_ALIGNMENT != 0){
+			throw runtime_error("Flat base is not aligned in memory");
+		}
+	}
+
+	string_view View::GetBytes(Section section) const{
+		const SectionEntry& entry = header_.sections[static_cast<size_t>(section)];
+		return file_->GetContents().substr(entry.offset, entry.size);
+	}
+
+	string_view View::GetString(StringRef ref) const{
+		const string_view strings = GetBytes(Section::STRINGS);
+		if (ref.offset > strings.size() || ref.size > strings.size() - ref.offset){
+			throw runtime_error("Corrupted flat base: name out of the string pool");
+		}
+		return strings.substr(ref.offset, ref.size);
+	}
+
+	size_t View::GetVertexCount() const{
+		return header_.vertex_count;
+	}
+
+	const shared_ptr<const io::MappedFile>& View::GetFile() const{
+		return file_;
+	}
+}
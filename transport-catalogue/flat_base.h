@@ -0,0 +1,170 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "ranges.h"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Base file of fixed-layout sections that is read in place from a mapped file.
+// The file starts with Header, every section is an array of one record type, aligned to 8 bytes.
+// Numbers are stored in the native byte order: a base is read on the platform it was made on.
+namespace flat_base{
+    inline constexpr char MAGIC[8] = { 'T', 'C', 'F', 'L', 'A', 'T', '\r', '\n' };
+    inline constexpr std::uint32_t VERSION = 2;
+
+    enum class Section : std::uint32_t{
+        STRINGS,            // char: names of stops and buses, referenced by StringRef
+        STOPS,              // StopRecord, the index in the array is the stop index
+        ROUTES,             // RouteRecord
+        ROUTE_STOPS,        // uint32_t stop indexes of all routes, as the catalogue adds them
+        DISTANCES,          // DistanceRecord
+        SETTINGS,           // char: proto_serialization::TransportCatalogue with the settings only
+        EDGES,              // EdgeRecord in the order of edge ids
+        VERTEXES,           // VertexesRecord for every stop index
+        ROUTER_WEIGHTS,     // double: row-major table of router::RoutesStorage
+        ROUTER_PREV_EDGES,  // uint32_t: row-major table of router::RoutesStorage
+        CH_RANKS,           // uint32_t: ranks of the contraction hierarchy
+        CH_SHORTCUTS,       // ShortcutRecord
+        ROUTE_DEPARTURES,   // double: departures of all routes, as RouteRecord refers to them
+        COUNT,
+    };
+
+    struct SectionEntry{
+        std::uint64_t offset = 0;
+        std::uint64_t size = 0;
+    };
+
+    struct Header{
+        char magic[8];
+        std::uint32_t version = VERSION;
+        std::uint32_t sections_count = static_cast<std::uint32_t>(Section::COUNT);
+        std::uint32_t vertex_count = 0;
+        std::uint32_t padding = 0;
+        SectionEntry sections[static_cast<size_t>(Section::COUNT)];
+    };
+
+    struct StringRef{
+        std::uint32_t offset = 0;
+        std::uint32_t size = 0;
+    };
+
+    struct StopRecord{
+        StringRef name;
+        double lat = 0.0;
+        double lng = 0.0;
+    };
+
+    struct RouteRecord{
+        StringRef name;
+        std::uint32_t stops_begin = 0;
+        std::uint32_t stops_count = 0;
+        std::uint32_t is_circular = 0;
+        std::uint32_t stop_count = 0;
+        std::uint32_t unique_stop_count = 0;
+        std::uint32_t departures_begin = 0;
+        std::uint32_t departures_count = 0;
+        std::uint32_t padding = 0;
+        std::int64_t route_length = 0;
+        double curvature = 0.0;
+    };
+
+    struct DistanceRecord{
+        std::uint32_t from = 0;
+        std::uint32_t to = 0;
+        std::uint32_t distance = 0;
+    };
+
+    enum class EdgeKind : std::uint32_t{
+        WAIT,     // name_index is a stop index
+        TRAVEL,   // name_index is a route index
+    };
+
+    struct EdgeRecord{
+        std::uint32_t from = 0;
+        std::uint32_t to = 0;
+        double weight = 0.0;
+        std::uint32_t name_index = 0;
+        EdgeKind kind = EdgeKind::WAIT;
+        std::int32_t span_count = 0;
+        std::uint32_t padding = 0;
+    };
+
+    struct VertexesRecord{
+        std::uint32_t wait = 0;
+        std::uint32_t travel = 0;
+    };
+
+    struct ShortcutRecord{
+        std::uint32_t from = 0;
+        std::uint32_t to = 0;
+        double weight = 0.0;
+        std::uint32_t first_edge = 0;
+        std::uint32_t second_edge = 0;
+    };
+
+    bool IsFlatBase(std::string_view contents);
+
+    template <typename Record>
+    std::string_view AsBytes(const Record* records, size_t count){
+        static_assert(std::is_trivially_copyable_v<Record>, "Sections hold plain records only");
+        return std::string_view(reinterpret_cast<const char*>(records), count * sizeof(Record));
+    }
+
+    // Collects the sections and writes the whole file at once.
+    class Writer{
+    public:
+        StringRef AddString(std::string_view value);
+        // Copies the records.
+        template <typename Record>
+        void SetSection(Section section, const std::vector<Record>& records){
+            SetSection(section, std::string(AsBytes(records.data(), records.size())));
+        }
+        void SetSection(Section section, std::string bytes);
+        // Does not copy the bytes, they must stay valid until Write. For big tables.
+        void SetSectionView(Section section, std::string_view bytes);
+        void SetVertexCount(size_t vertex_count);
+        void Write(std::ostream& output) const;
+    private:
+        std::string strings_;
+        std::vector<std::string> owned_sections_ = std::vector<std::string>(static_cast<size_t>(Section::COUNT));
+        std::vector<std::string_view> sections_ = std::vector<std::string_view>(static_cast<size_t>(Section::COUNT));
+        std::uint32_t vertex_count_ = 0;
+    };
+
+    // Typed access to the sections of a mapped base. The bounds and the alignment of every
+    // section are checked once here; the records are read right from the file.
+    class View{
+    public:
+        explicit View(std::shared_ptr<const io::MappedFile> file);
+
+        template <typename Record>
+        ranges::Range<const Record*> GetSection(Section section) const{
+            const std::string_view bytes = GetBytes(section);
+            if (bytes.size() % sizeof(Record) != 0){
+                throw std::runtime_error("Corrupted flat base: wrong section size");
+            }
+            const Record* begin = reinterpret_cast<const Record*>(bytes.data());
+            return { begin, begin + bytes.size() / sizeof(Record) };
+        }
+        std::string_view GetBytes(Section section) const;
+        std::string_view GetString(StringRef ref) const;
+        size_t GetVertexCount() const;
+        // Keeps the file mapped while the records are used in place.
+        const std::shared_ptr<const io::MappedFile>& GetFile() const;
+    private:
+        std::shared_ptr<const io::MappedFile> file_;
+        Header header_;
+    };
+
+    template <typename Record>
+    size_t GetSize(const ranges::Range<const Record*>& records){
+        return static_cast<size_t>(records.end() - records.begin());
+    }
+}
@@ -0,0 +1,98 @@
+#include "floyd_warshall.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define TC_FLOYD_WARSHALL_SSE2
+#if defined(__GNUC__) || defined(__clang__)
+#define TC_FLOYD_WARSHALL_AVX2
+#endif
+#endif
+
+using namespace std;
+namespace graph{
+	namespace{
+		using RelaxRowFunction = void (*)(double*, uint32_t*, const double*, const uint32_t*, double, uint32_t, uint32_t, size_t);
+
+		void RelaxRowScalar(double* weights, uint32_t* prev_edges, const double* through_weights,
+			const uint32_t* through_prev_edges, double weight_from, uint32_t prev_edge_from, uint32_t no_prev_edge, size_t count){
+			RelaxRow<double, uint32_t>(weights, prev_edges, through_weights, through_prev_edges, weight_from, prev_edge_from,
+				no_prev_edge, count);
+		}
+
+#ifdef TC_FLOYD_WARSHALL_SSE2
+		void RelaxRowSse2(double* weights, uint32_t* prev_edges, const double* through_weights,
+			const uint32_t* through_prev_edges, double weight_from, uint32_t prev_edge_from, uint32_t no_prev_edge, size_t count){
+			const __m128d weight_from_vector = _mm_set1_pd(weight_from);
+			size_t column = 0;
+			for (; column + 2 <= count; column += 2){
+				const __m128d candidate = _mm_add_pd(weight_from_vector, _mm_loadu_pd(through_weights + column));
+				const __m128d current = _mm_loadu_pd(weights + column);
+				const int mask = _mm_movemask_pd(_mm_cmplt_pd(candidate, current));
+				if (mask == 0){
+					continue;
+				}
+				_mm_storeu_pd(weights + column, _mm_min_pd(candidate, current));
+				for (size_t lane = 0; lane < 2; ++lane){
+					if (mask & (1 << lane)){
+						const uint32_t through_prev_edge = through_prev_edges[column + lane];
+						prev_edges[column + lane] = through_prev_edge != no_prev_edge ? through_prev_edge : prev_edge_from;
+					}
+				}
+			}
+			RelaxRowScalar(weights + column, prev_edges + column, through_weights + column, through_prev_edges + column,
+				weight_from, prev_edge_from, no_prev_edge, count - column);
+		}
+#endif
+
+#ifdef TC_FLOYD_WARSHALL_AVX2
+		__attribute__((target("avx2")))
+		void RelaxRowAvx2(double* weights, uint32_t* prev_edges, const double* through_weights,
+			const uint32_t* through_prev_edges, double weight_from, uint32_t prev_edge_from, uint32_t no_prev_edge, size_t count){
+			const __m256d weight_from_vector = _mm256_set1_pd(weight_from);
+			const __m128i prev_edge_from_vector = _mm_set1_epi32(static_cast<int>(prev_edge_from));
+			const __m128i no_prev_edge_vector = _mm_set1_epi32(static_cast<int>(no_prev_edge));
+			// Picks the low halves of four 64-bit comparison results as 32-bit lanes.
+			const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+			size_t column = 0;
+			for (; column + 4 <= count; column += 4){
+				const __m256d candidate = _mm256_add_pd(weight_from_vector, _mm256_loadu_pd(through_weights + column));
+				const __m256d current = _mm256_loadu_pd(weights + column);
+				const __m256d less = _mm256_cmp_pd(candidate, current, _CMP_LT_OQ);
+				if (_mm256_testz_pd(less, less)){
+					continue;
+				}
+				_mm256_storeu_pd(weights + column, _mm256_min_pd(candidate, current));
+
+				const __m128i lanes_mask = _mm256_castsi256_si128(
+					_mm256_permutevar8x32_epi32(_mm256_castpd_si256(less), low_halves));
+				const __m128i through_prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(through_prev_edges + column));
+				const __m128i candidate_prev = _mm_blendv_epi8(through_prev, prev_edge_from_vector,
+					_mm_cmpeq_epi32(through_prev, no_prev_edge_vector));
+				__m128i* prev_edges_address = reinterpret_cast<__m128i*>(prev_edges + column);
+				_mm_storeu_si128(prev_edges_address, _mm_blendv_epi8(_mm_loadu_si128(prev_edges_address), candidate_prev, lanes_mask));
+			}
+			RelaxRowScalar(weights + column, prev_edges + column, through_weights + column, through_prev_edges + column,
+				weight_from, prev_edge_from, no_prev_edge, count - column);
+		}
+#endif
+
+		RelaxRowFunction ChooseRelaxRow(){
+#ifdef TC_FLOYD_WARSHALL_AVX2
+			if (__builtin_cpu_supports("avx2")){
+				return RelaxRowAvx2;
+			}
+#endif
+#ifdef TC_FLOYD_WARSHALL_SSE2
+			return RelaxRowSse2;
+#else
+			return RelaxRowScalar;
+#endif
+		}
+	}
+
+	void RelaxRow(double* weights, uint32_t* prev_edges, const double* through_weights,
+		const uint32_t* through_prev_edges, double weight_from, uint32_t prev_edge_from, uint32_t no_prev_edge, size_t count){
+		static const RelaxRowFunction relax_row = ChooseRelaxRow();
+		relax_row(weights, prev_edges, through_weights, through_prev_edges, weight_from, prev_edge_from, no_prev_edge, count);
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "graph.h"
+#include "routes_storage.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace graph{
+    // Relaxes one row of the table through a vertex:
+    // weights[j] = min(weights[j], weight_from + through_weights[j]) for every column j.
+    // A missing route must have an infinite weight, so it never wins the comparison.
+    template <typename StoredWeight, typename EdgeIndex>
+    void RelaxRow(StoredWeight* weights, EdgeIndex* prev_edges, const StoredWeight* through_weights,
+        const EdgeIndex* through_prev_edges, StoredWeight weight_from, EdgeIndex prev_edge_from,
+        EdgeIndex no_prev_edge, size_t count){
+        for (size_t column = 0; column < count; ++column){
+            const StoredWeight candidate_weight = weight_from + through_weights[column];
+            if (candidate_weight < weights[column]){
+                weights[column] = candidate_weight;
+                prev_edges[column] = through_prev_edges[column] != no_prev_edge ? through_prev_edges[column] : prev_edge_from;
+            }
+        }
+    }
+
+    // SSE2/AVX2 version picked at runtime on x86-64, scalar one elsewhere.
+    void RelaxRow(double* weights, std::uint32_t* prev_edges, const double* through_weights,
+        const std::uint32_t* through_prev_edges, double weight_from, std::uint32_t prev_edge_from,
+        std::uint32_t no_prev_edge, size_t count);
+
+    // Floyd-Warshall over a dense table, blocked by BLOCK_SIZE intermediate vertices.
+    // The rows of the block are relaxed first and a copy of every through-row is kept as it
+    // was at its own step; then all other rows are processed in parallel tiles, each row going
+    // through the whole block while it stays in cache. Every cell sees the same sequence of
+    // relaxations as in the plain triple loop, so the table is bit-identical to it.
+    template <typename Weight, typename StoredWeight, typename EdgeIndex>
+    void RunFloydWarshall(FlatRoutesStorage<Weight, StoredWeight, EdgeIndex>& storage,
+        concurrency::ThreadPool* thread_pool = nullptr){
+        static_assert(std::numeric_limits<StoredWeight>::has_infinity, "Dense Floyd-Warshall needs infinite weights");
+        using Storage = FlatRoutesStorage<Weight, StoredWeight, EdgeIndex>;
+        constexpr size_t BLOCK_SIZE = 32;
+        constexpr size_t ROWS_IN_TILE = 16;
+
+        const size_t vertex_count = storage.GetVertexCount();
+        std::vector<StoredWeight> through_weights(std::min(BLOCK_SIZE, vertex_count) * vertex_count);
+        std::vector<EdgeIndex> through_prev_edges(through_weights.size());
+
+        auto relax_row = [&](VertexId vertex_from, VertexId vertex_through, VertexId block_begin){
+            StoredWeight* weights = storage.GetWeightsRow(vertex_from);
+            EdgeIndex* prev_edges = storage.GetPrevEdgesRow(vertex_from);
+            if (vertex_through == vertex_from || !(weights[vertex_through] < Storage::NO_WEIGHT)){
+                return;
+            }
+            const size_t offset = (vertex_through - block_begin) * vertex_count;
+            RelaxRow(weights, prev_edges, through_weights.data() + offset, through_prev_edges.data() + offset,
+                weights[vertex_through], prev_edges[vertex_through], Storage::NO_PREV_EDGE, vertex_count);
+        };
+
+        for (VertexId block_begin = 0; block_begin < vertex_count; block_begin += BLOCK_SIZE){
+            const VertexId block_end = std::min(block_begin + BLOCK_SIZE, vertex_count);
+            for (VertexId vertex_through = block_begin; vertex_through < block_end; ++vertex_through){
+                const size_t offset = (vertex_through - block_begin) * vertex_count;
+                std::copy_n(storage.GetWeightsRow(vertex_through), vertex_count, through_weights.begin() + offset);
+                std::copy_n(storage.GetPrevEdgesRow(vertex_through), vertex_count, through_prev_edges.begin() + offset);
+                for (VertexId vertex_from = block_begin; vertex_from < block_end; ++vertex_from){
+                    relax_row(vertex_from, vertex_through, block_begin);
+                }
+            }
+
+            const size_t outer_rows = vertex_count - (block_end - block_begin);
+            const size_t tiles_count = (outer_rows + ROWS_IN_TILE - 1) / ROWS_IN_TILE;
+            auto relax_tile = [&](size_t tile){
+                const size_t tile_end = std::min((tile + 1) * ROWS_IN_TILE, outer_rows);
+                for (size_t row = tile * ROWS_IN_TILE; row < tile_end; ++row){
+                    const VertexId vertex_from = row < block_begin ? row : row + (block_end - block_begin);
+                    for (VertexId vertex_through = block_begin; vertex_through < block_end; ++vertex_through){
+                        relax_row(vertex_from, vertex_through, block_begin);
+                    }
+                }
+            };
+            if (thread_pool != nullptr && tiles_count > 1){
+                thread_pool->ParallelFor(tiles_count, relax_tile);
+            }
+            else{
+                for (size_t tile = 0; tile < tiles_count; ++tile){
+                    relax_tile(tile);
+                }
+            }
+        }
+    }
+}
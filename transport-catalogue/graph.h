@@ -1,6 +1,7 @@
 #pragma once
 #include "ranges.h"
 #include <cstdlib>
+#include <string_view>
 #include <vector>
 
 namespace graph{
@@ -16,7 +17,8 @@ struct Edge{
     VertexId from;
     VertexId to;
     Weight weight;
-    std::string edge_name;
+    // Name of the stop or the bus, owned by the transport catalogue.
+    std::string_view edge_name;
     EdgeType type;
     int span_count = 0;
 };
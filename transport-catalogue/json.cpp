@@ -1,104 +1,204 @@
 #include "json.h"
+#include <cctype>
 #include <iterator>
 using namespace std;
 namespace json{
 
 
 
-Node LoadNode(istream& input);
-Node LoadString(istream& input);
-
-string LoadLiteral(istream& input){
-    string s;
-    while (isalpha(input.peek())){
-        s.push_back(static_cast<char>(input.get()));
+char Unescape(int escaped_char){
+    switch (escaped_char){
+    case 'n':
+        return '\n';
+    case 't':
+        return '\t';
+    case 'r':
+        return '\r';
+    case '"':
+        return '"';
+    case '\\':
+        return '\\';
+    default:
+        throw ParsingError("Unrecognized escape sequence \\"s + static_cast<char>(escaped_char));
     }
-    return s;
 }
 
-Node LoadArray(istream& input){
-    vector<Node> result;
-    for (char c; input >> c && c != ']';){
-        if (c != ','){
-            input.putback(c);
+// Reads characters straight from the stream buffer, avoiding a sentry per character.
+class StreamReader{
+public:
+    explicit StreamReader(istream& input)
+        : buffer_(*input.rdbuf())
+    {}
+    int Peek(){
+        return buffer_.sgetc();
+    }
+    int Get(){
+        return buffer_.sbumpc();
+    }
+    // Reads the rest of a string after the opening quote. The result lives until the next call.
+    string_view ReadString(){
+        scratch_.clear();
+        while (true){
+            const int ch = Get();
+            if (IsEnd(ch)){
+                throw ParsingError("String parsing error");
+            }
+            if (ch == '"'){
+                return scratch_;
+            }
+            else if (ch == '\\'){
+                const int escaped_char = Get();
+                if (IsEnd(escaped_char)){
+                    throw ParsingError("String parsing error");
+                }
+                scratch_.push_back(Unescape(escaped_char));
+            }
+            else if (ch == '\n' || ch == '\r'){
+                throw ParsingError("Unexpected end of line"s);
+            }
+            else{
+                scratch_.push_back(static_cast<char>(ch));
+            }
         }
-        result.push_back(LoadNode(input));
     }
-    if (!input){
-        throw ParsingError("Array parsing error"s);
+    static bool IsEnd(int ch){
+        return ch == char_traits<char>::eof();
     }
-    return Node(move(result));
-}
-    
-Node LoadDict(istream& input) {
-            Dict result;
-            char c;
-            for (; input >> c && c != '}';) {
-                if (c == ',') {
-                    input >> c;
+private:
+    streambuf& buffer_;
+    string scratch_;
+};
+
+// Reads a contiguous buffer. Strings without escapes are returned as slices of it.
+class BufferReader{
+public:
+    explicit BufferReader(string_view buffer)
+        : position_(buffer.data())
+        , end_(buffer.data() + buffer.size())
+    {}
+    int Peek(){
+        return position_ != end_ ? static_cast<unsigned char>(*position_) : char_traits<char>::eof();
+    }
+    int Get(){
+        return position_ != end_ ? static_cast<unsigned char>(*position_++) : char_traits<char>::eof();
+    }
+    // Reads the rest of a string after the opening quote. The result lives until the next call
+    // or, when the string has no escapes, as long as the buffer.
+    string_view ReadString(){
+        const char* begin = position_;
+        while (position_ != end_ && *position_ != '"' && *position_ != '\\' && *position_ != '\n' && *position_ != '\r'){
+            ++position_;
+        }
+        if (position_ != end_ && *position_ == '"'){
+            return string_view(begin, position_++ - begin);
+        }
+        scratch_.assign(begin, position_);
+        while (true){
+            const int ch = Get();
+            if (IsEnd(ch)){
+                throw ParsingError("String parsing error");
+            }
+            if (ch == '"'){
+                return scratch_;
+            }
+            else if (ch == '\\'){
+                const int escaped_char = Get();
+                if (IsEnd(escaped_char)){
+                    throw ParsingError("String parsing error");
                 }
-                string key = LoadString(input).AsString();
-                input >> c;
-                result.insert({ move(key), LoadNode(input) });
+                scratch_.push_back(Unescape(escaped_char));
             }
-            if (c != '}') {
-                throw ParsingError("Map parsing error");
+            else if (ch == '\n' || ch == '\r'){
+                throw ParsingError("Unexpected end of line"s);
+            }
+            else{
+                scratch_.push_back(static_cast<char>(ch));
             }
-            return Node(move(result));
         }
+    }
+    static bool IsEnd(int ch){
+        return ch == char_traits<char>::eof();
+    }
+private:
+    const char* position_;
+    const char* end_;
+    string scratch_;
+};
+
+// Skips whitespace and returns the next character without extracting it.
+template <typename Reader>
+int PeekSignificant(Reader& input){
+    int ch = input.Peek();
+    while (!Reader::IsEnd(ch) && isspace(ch)){
+        input.Get();
+        ch = input.Peek();
+    }
+    return ch;
+}
 
-Node LoadString(istream& input){
-    auto it = istreambuf_iterator<char>(input);
-    auto end = istreambuf_iterator<char>();
+template <typename Reader>
+void ParseNode(Reader& input, Handler& handler);
+
+template <typename Reader>
+string LoadLiteral(Reader& input){
     string s;
+    while (!Reader::IsEnd(input.Peek()) && isalpha(input.Peek())){
+        s.push_back(static_cast<char>(input.Get()));
+    }
+    return s;
+}
+
+template <typename Reader>
+void ParseArray(Reader& input, Handler& handler){
+    handler.StartArray();
     while (true){
-        if (it == end)
-        {
-            throw ParsingError("String parsing error");
+        const int ch = PeekSignificant(input);
+        if (Reader::IsEnd(ch)){
+            throw ParsingError("Array parsing error"s);
         }
-        const char ch = *it;
-        if (ch == '"'){
-            ++it;
+        if (ch == ']'){
+            input.Get();
             break;
         }
-        else if (ch == '\\'){
-            ++it;
-            if (it == end){
-                throw ParsingError("String parsing error");
-            }
-            const char escaped_char = *(it);
-            switch (escaped_char){
-            case 'n':
-                s.push_back('\n');
-                break;
-            case 't':
-                s.push_back('\t');
-                break;
-            case 'r':
-                s.push_back('\r');
-                break;
-            case '"':
-                s.push_back('"');
-                break;
-            case '\\':
-                s.push_back('\\');
-                break;
-            default:
-                throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
-            }
+        if (ch == ','){
+            input.Get();
+        }
+        ParseNode(input, handler);
+    }
+    handler.EndArray();
+}
+
+template <typename Reader>
+void ParseDict(Reader& input, Handler& handler){
+    handler.StartDict();
+    while (true){
+        int ch = PeekSignificant(input);
+        if (Reader::IsEnd(ch)){
+            throw ParsingError("Map parsing error");
+        }
+        input.Get();
+        if (ch == '}'){
+            break;
         }
-        else if (ch == '\n' || ch == '\r'){
-            throw ParsingError("Unexpected end of line"s);
+        if (ch == ','){
+            ch = PeekSignificant(input);
+            input.Get();
         }
-        else{
-            s.push_back(ch);
+        if (ch != '"'){
+            throw ParsingError("Map parsing error");
+        }
+        handler.Key(input.ReadString());
+        if (PeekSignificant(input) != ':'){
+            throw ParsingError("Map parsing error");
         }
-        ++it;
+        input.Get();
+        ParseNode(input, handler);
     }
-    return Node(move(s));
+    handler.EndDict();
 }
 
-Node LoadBool(istream& input)
+template <typename Reader>
+Node LoadBool(Reader& input)
 {
     const auto s = LoadLiteral(input);
     if (s == "true"sv){
@@ -112,7 +212,8 @@ Node LoadBool(istream& input)
     }
 }
 
-Node LoadNull(istream& input)
+template <typename Reader>
+Node LoadNull(Reader& input)
 {
     if (auto literal = LoadLiteral(input); literal == "null"sv){
         return Node{ nullptr };
@@ -122,28 +223,34 @@ Node LoadNull(istream& input)
     }
 }
 
-Node LoadNumber(istream& input)
+template <typename Reader>
+Node LoadNumber(Reader& input)
 {
     string parsed_num;
     auto read_char = [&parsed_num, &input]{
-        parsed_num += static_cast<char>(input.get());
-        if (!input){
+        const int ch = input.Get();
+        if (Reader::IsEnd(ch)){
             throw ParsingError("Failed to read number from stream"s);
         }
+        parsed_num += static_cast<char>(ch);
     };
-    auto read_digits = [&input, read_char]{
-        if (!isdigit(input.peek())){
+    auto is_digit = [&input]{
+        const int ch = input.Peek();
+        return !Reader::IsEnd(ch) && isdigit(ch);
+    };
+    auto read_digits = [read_char, is_digit]{
+        if (!is_digit()){
             throw ParsingError("A digit is expected"s);
         }
-        while (isdigit(input.peek())){
+        while (is_digit()){
             read_char();
         }
     };
 
-    if (input.peek() == '-'){
+    if (input.Peek() == '-'){
         read_char();
     }
-    if (input.peek() == '0'){
+    if (input.Peek() == '0'){
         read_char();
     }
     else{
@@ -151,15 +258,15 @@ Node LoadNumber(istream& input)
     }
 
     bool is_int = true;
-    if (input.peek() == '.'){
+    if (input.Peek() == '.'){
         read_char();
         read_digits();
         is_int = false;
     }
 
-    if (int ch = input.peek(); ch == 'e' || ch == 'E'){
+    if (int ch = input.Peek(); ch == 'e' || ch == 'E'){
         read_char();
-        if (ch = input.peek(); ch == '+' || ch == '-'){
+        if (ch = input.Peek(); ch == '+' || ch == '-'){
             read_char();
         }
         read_digits();
@@ -180,44 +287,125 @@ Node LoadNumber(istream& input)
     }
 }
 
-Node LoadNode(istream& input){
-    char c;
-    input >> c;
-    switch (c){
+template <typename Reader>
+void ParseNode(Reader& input, Handler& handler){
+    const int ch = PeekSignificant(input);
+    switch (ch){
     case '[':
-        return LoadArray(input);
+        input.Get();
+        ParseArray(input, handler);
+        break;
     case '{':
-        return LoadDict(input);
+        input.Get();
+        ParseDict(input, handler);
+        break;
     case '"':
-        return LoadString(input);
+        input.Get();
+        handler.String(input.ReadString());
+        break;
     case 't':
         [[fallthrough]];
     case 'f':
-        input.putback(c);
-        return LoadBool(input);
+        handler.Value(LoadBool(input));
+        break;
     case 'n':
-        input.putback(c);
-        return LoadNull(input);
+        handler.Value(LoadNull(input));
+        break;
     default:
-        input.putback(c);
-        return LoadNumber(input);
+        if (Reader::IsEnd(ch)){
+            throw ParsingError("Unexpected end of input"s);
+        }
+        handler.Value(LoadNumber(input));
+        break;
+    }
+}
+
+void NodeHandler::StartDict(){
+    containers_.emplace_back(Dict{});
+}
+
+void NodeHandler::Key(string_view key){
+    keys_.emplace_back(key);
+}
+
+void NodeHandler::EndDict(){
+    Node dict = move(containers_.back());
+    containers_.pop_back();
+    Attach(move(dict));
+}
+
+void NodeHandler::StartArray(){
+    containers_.emplace_back(Array{});
+}
+
+void NodeHandler::EndArray(){
+    Node array = move(containers_.back());
+    containers_.pop_back();
+    Attach(move(array));
+}
+
+void NodeHandler::String(string_view value){
+    Attach(Node(string(value)));
+}
+
+void NodeHandler::Value(Node value){
+    Attach(move(value));
+}
+
+bool NodeHandler::IsComplete() const{
+    return complete_;
+}
+
+Node NodeHandler::Extract(){
+    if (!complete_){
+        throw logic_error("Extract() called for not finished value"s);
+    }
+    complete_ = false;
+    return move(root_);
+}
+
+void NodeHandler::Attach(Node node){
+    if (containers_.empty()){
+        root_ = move(node);
+        complete_ = true;
+        return;
+    }
+    auto& container = containers_.back().GetValue();
+    if (holds_alternative<Array>(container)){
+        get<Array>(container).push_back(move(node));
+    }
+    else{
+        // The first of duplicate keys wins.
+        get<Dict>(container).insert({ move(keys_.back()), move(node) });
+        keys_.pop_back();
     }
 }
 
 struct PrintContext{
     ostream& out;
-    int indent_step = 4;
+    int indent_step = INDENT_STEP;
     int indent = 0;
+    bool compact = false;
     void PrintIndent() const{
         for (int i = 0; i < indent; ++i){
             out.put(' ');
         }
     }
+    void PrintLineBreak() const{
+        if (!compact){
+            out.put('\n');
+        }
+    }
     PrintContext Indented() const{
-        return { out, indent_step, indent_step + indent };
+        return { out, indent_step, indent_step + indent, compact };
     }
 };
 
+PrintContext MakePrintContext(ostream& output, PrintMode mode){
+    const bool compact = mode == PrintMode::COMPACT;
+    return PrintContext{ output, compact ? 0 : INDENT_STEP, 0, compact };
+}
+
 void PrintNode(const Node& value, const PrintContext& ctx);
 
 template <typename Value>
@@ -267,7 +455,8 @@ template <>
 void PrintValue<Array>(const Array& nodes, const PrintContext& ctx)
 {
     ostream& out = ctx.out;
-    out << "[\n"sv;
+    out.put('[');
+    ctx.PrintLineBreak();
     bool first = true;
     auto inner_ctx = ctx.Indented();
     for (const Node& node : nodes){
@@ -276,12 +465,13 @@ void PrintValue<Array>(const Array& nodes, const PrintContext& ctx)
         }
         else
         {
-            out << ",\n"sv;
+            out.put(',');
+            ctx.PrintLineBreak();
         }
         inner_ctx.PrintIndent();
         PrintNode(node, inner_ctx);
     }
-    out.put('\n');
+    ctx.PrintLineBreak();
     ctx.PrintIndent();
     out.put(']');
 }
@@ -289,7 +479,8 @@ void PrintValue<Array>(const Array& nodes, const PrintContext& ctx)
 template <>
 void PrintValue<Dict>(const Dict& nodes, const PrintContext& ctx){
     ostream& out = ctx.out;
-    out << "{\n"sv;
+    out.put('{');
+    ctx.PrintLineBreak();
     bool first = true;
     auto inner_ctx = ctx.Indented();
     for (const auto& [key, node] : nodes){
@@ -297,27 +488,84 @@ void PrintValue<Dict>(const Dict& nodes, const PrintContext& ctx){
             first = false;
         }
         else{
-            out << ",\n"sv;
+            out.put(',');
+            ctx.PrintLineBreak();
         }
         inner_ctx.PrintIndent();
         PrintString(key, ctx.out);
-        out << ": "sv;
+        out << (ctx.compact ? ":"sv : ": "sv);
         PrintNode(node, inner_ctx);
     }
-    out.put('\n');
+    ctx.PrintLineBreak();
     ctx.PrintIndent();
     out.put('}');
 }
-void Print(const Document& doc, ostream& output){
-    PrintNode(doc.GetRoot(), PrintContext{ output });
+void Print(const Document& doc, ostream& output, PrintMode mode){
+    PrintNode(doc.GetRoot(), MakePrintContext(output, mode));
 }
 
 void PrintNode(const Node& node, const PrintContext& ctx){
     visit([&ctx](const auto& value){PrintValue(value, ctx);},node.GetValue());
 }
 
+ArrayPrinter::ArrayPrinter(ostream& output, PrintMode mode)
+    : output_(output), mode_(mode)
+{
+    const auto ctx = MakePrintContext(output_, mode_);
+    output_.put('[');
+    ctx.PrintLineBreak();
+}
+
+void ArrayPrinter::Print(const Node& node){
+    const auto inner_ctx = MakePrintContext(output_, mode_).Indented();
+    PrintSeparator();
+    inner_ctx.PrintIndent();
+    PrintNode(node, inner_ctx);
+}
+
+void ArrayPrinter::PrintRendered(string_view element){
+    const auto inner_ctx = MakePrintContext(output_, mode_).Indented();
+    PrintSeparator();
+    inner_ctx.PrintIndent();
+    output_ << element;
+}
+
+void ArrayPrinter::Finish(){
+    const auto ctx = MakePrintContext(output_, mode_);
+    ctx.PrintLineBreak();
+    output_.put(']');
+}
+
+void ArrayPrinter::PrintSeparator(){
+    if (first_){
+        first_ = false;
+    }
+    else{
+        output_.put(',');
+        MakePrintContext(output_, mode_).PrintLineBreak();
+    }
+}
+
+void Parse(istream& input, Handler& handler){
+    StreamReader reader(input);
+    ParseNode(reader, handler);
+}
+
+void Parse(string_view input, Handler& handler){
+    BufferReader reader(input);
+    ParseNode(reader, handler);
+}
+
 Document Load(istream& input){
-    return Document{ LoadNode(input) };
+    NodeHandler handler;
+    Parse(input, handler);
+    return Document{ handler.Extract() };
+}
+
+Document Load(string_view input){
+    NodeHandler handler;
+    Parse(input, handler);
+    return Document{ handler.Extract() };
 }
 
 Node::Node(Value value) : variant(std::move(value))
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -133,7 +134,80 @@ inline bool operator!=(const Document& lhs, const Document& rhs){
     return !(lhs == rhs);
 }
 
+// Receives the events of json::Parse in document order. Numbers, bools and null arrive
+// as Value; a Dict key arrives as Key right before its value. The views passed to Key and
+// String are valid only during the call.
+class Handler{
+public:
+    virtual void StartDict() = 0;
+    virtual void Key(std::string_view key) = 0;
+    virtual void EndDict() = 0;
+    virtual void StartArray() = 0;
+    virtual void EndArray() = 0;
+    virtual void String(std::string_view value) = 0;
+    virtual void Value(Node value) = 0;
+protected:
+    ~Handler() = default;
+};
+
+// Assembles one Node from the events of a single JSON value.
+class NodeHandler final : public Handler{
+public:
+    void StartDict() override;
+    void Key(std::string_view key) override;
+    void EndDict() override;
+    void StartArray() override;
+    void EndArray() override;
+    void String(std::string_view value) override;
+    void Value(Node value) override;
+
+    bool IsComplete() const;
+    // Returns the assembled value and gets ready for the next one.
+    Node Extract();
+private:
+    void Attach(Node node);
+
+    std::vector<Node> containers_;
+    std::vector<std::string> keys_;
+    Node root_;
+    bool complete_ = false;
+};
+
+// Reads one JSON value from input and reports it to handler without building a Node.
+void Parse(std::istream& input, Handler& handler);
+// Same for a contiguous buffer, e.g. a mapped file: strings without escapes are passed
+// to the handler as slices of input and are not copied.
+void Parse(std::string_view input, Handler& handler);
 Document Load(std::istream& input);
-void Print(const Document& doc, std::ostream& output);
+Document Load(std::string_view input);
+
+inline constexpr int INDENT_STEP = 4;
+
+// INDENTED puts every element on its own line, COMPACT prints no whitespace at all.
+enum class PrintMode{
+    INDENTED,
+    COMPACT,
+};
+
+void Print(const Document& doc, std::ostream& output, PrintMode mode = PrintMode::INDENTED);
+
+// Prints an array one element at a time, so the elements need not be kept until the end.
+// The output is the same as Print of the whole array.
+class ArrayPrinter{
+public:
+    explicit ArrayPrinter(std::ostream& output, PrintMode mode = PrintMode::INDENTED);
+    void Print(const Node& node);
+    // Prints an element rendered beforehand with the indentation of an array element,
+    // e.g. by json::Writer with indent INDENT_STEP.
+    void PrintRendered(std::string_view element);
+    // Closes the array; must be called once after the last element.
+    void Finish();
+private:
+    void PrintSeparator();
+
+    std::ostream& output_;
+    PrintMode mode_;
+    bool first_ = true;
+};
 
 } 
\ No newline at end of file
@@ -2,13 +2,163 @@
 using namespace std;
 namespace json_reader{
 
-	void ProcessBaseJSON(transport_catalogue::TransportCatalogue& tc,map_renderer::MapRenderer& mr,istream& input){
-		const json::Document j_doc = json::Load(input);
-		const json::Dict j_dict = j_doc.GetRoot().AsDict();
-		const auto base_requests_it = j_dict.find("base_requests"s);
-		if (base_requests_it != j_dict.cend()){
-			AddToDataBase(tc, base_requests_it->second.AsArray());
+	BaseJSONHandler::BaseJSONHandler(transport_catalogue::TransportCatalogue& tc) : tc_(tc)
+	{}
+
+	void BaseJSONHandler::StartDict(){
+		if (building_node_){
+			node_handler_.StartDict();
+		}
+		else if (depth_ == 0){
+			++depth_;
+		}
+		else{
+			building_node_ = true;
+			node_handler_.StartDict();
+		}
+	}
+
+	void BaseJSONHandler::Key(string_view key){
+		if (building_node_){
+			node_handler_.Key(key);
+		}
+		else{
+			section_ = key;
+		}
+	}
+
+	void BaseJSONHandler::EndDict(){
+		if (building_node_){
+			node_handler_.EndDict();
+			CompleteNode();
+		}
+		else{
+			--depth_;
+		}
+	}
+
+	void BaseJSONHandler::StartArray(){
+		if (building_node_){
+			node_handler_.StartArray();
+		}
+		else if (depth_ == 0){
+			throw json::ParsingError("Base JSON should be a dict"s);
+		}
+		else if (depth_ == 1 && section_ == "base_requests"s){
+			in_base_requests_ = true;
+			++depth_;
+		}
+		else{
+			building_node_ = true;
+			node_handler_.StartArray();
+		}
+	}
+
+	void BaseJSONHandler::EndArray(){
+		if (building_node_){
+			node_handler_.EndArray();
+			CompleteNode();
+		}
+		else{
+			AddPendingRequests();
+			in_base_requests_ = false;
+			--depth_;
+		}
+	}
+
+	void BaseJSONHandler::String(string_view value){
+		if (depth_ == 0){
+			throw json::ParsingError("Base JSON should be a dict"s);
+		}
+		node_handler_.String(value);
+		CompleteNode();
+	}
+
+	void BaseJSONHandler::Value(json::Node value){
+		if (depth_ == 0){
+			throw json::ParsingError("Base JSON should be a dict"s);
+		}
+		node_handler_.Value(move(value));
+		CompleteNode();
+	}
+
+	const json::Dict& BaseJSONHandler::GetSettings() const{
+		return settings_;
+	}
+
+	void BaseJSONHandler::CompleteNode(){
+		if (!node_handler_.IsComplete()){
+			return;
+		}
+		building_node_ = false;
+		json::Node node = node_handler_.Extract();
+		if (in_base_requests_){
+			AddBaseRequest(move(node));
+		}
+		else{
+			settings_.insert({ section_, move(node) });
+		}
+	}
+
+	void BaseJSONHandler::AddBaseRequest(json::Node request){
+		const json::Dict& j_dict = request.AsDict();
+		const auto request_type = j_dict.find("type"s);
+		if (request_type == j_dict.end()){
+			return;
+		}
+		if (request_type->second.AsString() == "Stop"s){
+			AddStopData(tc_, j_dict);
+			const transport_catalogue::Stop* from_ptr = tc_.GetStopByName(j_dict.at("name"s).AsString());
+			for (const auto& [to_stop_name, distance] : j_dict.at("road_distances"s).AsDict()){
+				const transport_catalogue::Stop* to_ptr = tc_.GetStopByName(to_stop_name);
+				if (to_ptr != nullptr){
+					tc_.AddDistance(from_ptr, to_ptr, static_cast<size_t>(distance.AsInt()));
+				}
+				else{
+					pending_distances_.push_back({ from_ptr, to_stop_name, static_cast<size_t>(distance.AsInt()) });
+				}
+			}
+		}
+		else if (request_type->second.AsString() == "Bus"s){
+			const json::Array& stops = j_dict.at("stops"s).AsArray();
+			const bool stops_known = all_of(stops.begin(), stops.end(), [this](const json::Node& stop){
+				return tc_.GetStopByName(stop.AsString()) != nullptr;
+			});
+			// Buses keep their order, so once one waits for its stops the next ones wait too.
+			if (stops_known && pending_buses_.empty()){
+				AddRouteData(tc_, j_dict);
+			}
+			else{
+				pending_buses_.push_back(move(request));
+			}
 		}
+	}
+
+	void BaseJSONHandler::AddPendingRequests(){
+		for (const auto& [from_ptr, to_stop_name, distance] : pending_distances_){
+			tc_.AddDistance(from_ptr, tc_.GetStopByName(to_stop_name), distance);
+		}
+		pending_distances_.clear();
+		for (const auto& bus : pending_buses_){
+			AddRouteData(tc_, bus.AsDict());
+		}
+		pending_buses_.clear();
+	}
+
+	void ProcessBaseJSON(transport_catalogue::TransportCatalogue& tc,map_renderer::MapRenderer& mr,istream& input){
+		BaseJSONHandler handler(tc);
+		json::Parse(input, handler);
+		ProcessBaseSettings(tc, mr, handler.GetSettings());
+	}
+
+	void ProcessBaseJSON(transport_catalogue::TransportCatalogue& tc, map_renderer::MapRenderer& mr, string_view input){
+		BaseJSONHandler handler(tc);
+		json::Parse(input, handler);
+		ProcessBaseSettings(tc, mr, handler.GetSettings());
+	}
+
+	void ProcessBaseSettings(transport_catalogue::TransportCatalogue& tc, map_renderer::MapRenderer& mr, const json::Dict& j_dict){
+		tc.Finalize();
 		const auto renderer_settings_it = j_dict.find("render_settings"s);
 		if (renderer_settings_it != j_dict.cend()){
 			ReadRendererSettings(mr, renderer_settings_it->second.AsDict());
@@ -20,28 +170,122 @@ namespace json_reader{
 		}
 		const auto serialization_settings_it = j_dict.find("serialization_settings"s);
 		if (serialization_settings_it != j_dict.cend()){
-			const string serialization_filename = ReadSerializationSettings(serialization_settings_it->second.AsDict());
+			const serialization::SerializationSettings serialization_settings
+				= ReadSerializationSettings(serialization_settings_it->second.AsDict());
+			if (serialization_settings.store_rendered_map){
+				mr.ApplyRenderedMap(transport_catalogue::RequestHandler(tc, mr).GetRenderedMap());
+			}
+			tr.BuildGraph();
+			tr.BuildRouter();
 			serialization::Serializer serializer(tc, mr, &tr);
-			serializer.Serialize(serialization_filename);
+			serializer.Serialize(serialization_settings.file, serialization_settings.format);
 		}
 	}
 
 	void ProcessRequestJSON(transport_catalogue::TransportCatalogue& tc, map_renderer::MapRenderer& mr,istream& input, ostream& output){
-		const json::Document j_doc = json::Load(input);
-		const json::Dict j_dict = j_doc.GetRoot().AsDict();
+		ProcessRequests(tc, mr, json::Load(input).GetRoot().AsDict(), output);
+	}
+
+	void ProcessRequestJSON(transport_catalogue::TransportCatalogue& tc, map_renderer::MapRenderer& mr, string_view input, ostream& output){
+		ProcessRequests(tc, mr, json::Load(input).GetRoot().AsDict(), output);
+	}
+
+	void ProcessRequests(transport_catalogue::TransportCatalogue& tc, map_renderer::MapRenderer& mr, const json::Dict& j_dict, ostream& output){
 		transport_catalogue::RequestHandler rh(tc, mr);
 		const auto serialization_settings_it = j_dict.find("serialization_settings"s);
 		if (serialization_settings_it != j_dict.cend()){
-			const string serialization_filename = ReadSerializationSettings(serialization_settings_it->second.AsDict());
+			const serialization::SerializationSettings serialization_settings
+				= ReadSerializationSettings(serialization_settings_it->second.AsDict());
 			serialization::Serializer serializer(tc, mr, nullptr);
-			serializer.Deserialize(serialization_filename);
+			serializer.Deserialize(serialization_settings.file);
 			router::TransportRouter tr(tc);
 			serializer.DeserializeRouter(&tr);
 			const auto stat_requests_it = j_dict.find("stat_requests"s);
 			if (stat_requests_it != j_dict.cend()){
-				ParseRawJSONQueries(rh, tr, stat_requests_it->second.AsArray(), output);
+				ParseRawJSONQueries(rh, tr, stat_requests_it->second.AsArray(), output, ReadOutputSettings(j_dict),
+					ReadMatrixDirectory(j_dict));
+			}
+		}
+	}
+
+	void ServeRequestJSON(transport_catalogue::TransportCatalogue& tc, map_renderer::MapRenderer& mr, string_view settings,
+		istream& queries, ostream& output){
+		ServeRequests(tc, mr, json::Load(settings).GetRoot().AsDict(), queries, output);
+	}
+
+	void ServeRequests(transport_catalogue::TransportCatalogue& tc, map_renderer::MapRenderer& mr, const json::Dict& settings,
+		istream& queries, ostream& output){
+		transport_catalogue::RequestHandler rh(tc, mr);
+		router::TransportRouter tr(tc);
+		LoadBase(tc, mr, tr, settings);
+		string line;
+		string answer;
+		while (getline(queries, line)){
+			if (IsBlankLine(line)){
+				continue;
+			}
+			answer.clear();
+			AnswerQueryLine(rh, tr, line, answer);
+			output.write(answer.data(), static_cast<streamsize>(answer.size()));
+			output.flush();
+		}
+	}
+
+	void ListenRequests(transport_catalogue::TransportCatalogue& tc, map_renderer::MapRenderer& mr, const json::Dict& settings){
+		const auto server_settings_it = settings.find("server_settings"s);
+		if (server_settings_it == settings.cend()){
+			throw invalid_argument("The server needs server_settings");
+		}
+		const server::ServerSettings server_settings = ReadServerSettings(server_settings_it->second.AsDict());
+		transport_catalogue::RequestHandler rh(tc, mr);
+		router::TransportRouter tr(tc);
+		LoadBase(tc, mr, tr, settings);
+		server::QueryServer query_server(server_settings, [&rh, &tr](string_view query, string& answer){
+			AnswerQueryLine(rh, tr, query, answer);
+		});
+		query_server.Run();
+	}
+
+	void LoadBase(transport_catalogue::TransportCatalogue& tc, map_renderer::MapRenderer& mr, router::TransportRouter& tr,
+		const json::Dict& settings){
+		const auto serialization_settings_it = settings.find("serialization_settings"s);
+		if (serialization_settings_it == settings.cend()){
+			throw invalid_argument("Loading a base needs serialization_settings");
+		}
+		const serialization::SerializationSettings serialization_settings
+			= ReadSerializationSettings(serialization_settings_it->second.AsDict());
+		serialization::Serializer serializer(tc, mr, nullptr);
+		serializer.Deserialize(serialization_settings.file);
+		serializer.DeserializeRouter(&tr);
+		// Bases without router data get it built here, before any query, so that the queries
+		// only read the router.
+		tr.Build();
+	}
+
+	bool IsBlankLine(string_view line){
+		return all_of(line.begin(), line.end(), [](unsigned char c){ return isspace(c); });
+	}
+
+	void AnswerQueryLine(const transport_catalogue::RequestHandler& rh, const router::TransportRouter& tr,
+		string_view line, string& answer){
+		const size_t answer_begin = answer.size();
+		// A bad line is answered with an error, so that one client can't stop the others.
+		try{
+			const json::Document query = json::Load(line);
+			json::Writer writer(answer, json::PrintMode::COMPACT);
+			if (!ProcessQuery(rh, tr, query.GetRoot(), writer)){
+				json::Writer(answer, json::PrintMode::COMPACT).StartDict()
+					.Key("error_message"sv).Value("unknown request type"sv)
+					.EndDict();
 			}
 		}
+		catch (const exception& e){
+			answer.resize(answer_begin);
+			json::Writer(answer, json::PrintMode::COMPACT).StartDict()
+				.Key("error_message"sv).Value(string_view(e.what()))
+				.EndDict();
+		}
+		answer += '\n';
 	}
 
 	void AddToDataBase(transport_catalogue::TransportCatalogue& tc, const json::Array& j_arr){
@@ -69,17 +313,17 @@ namespace json_reader{
 	}
 
 	void AddStopData(transport_catalogue::TransportCatalogue& tc, const json::Dict& j_dict){
-		const string stop_name = j_dict.at("name"s).AsString();
+		const string& stop_name = j_dict.at("name"s).AsString();
 		const double latitude = j_dict.at("latitude"s).AsDouble();
 		const double longitude = j_dict.at("longitude"s).AsDouble();
 		tc.AddStop(transport_catalogue::Stop{ stop_name, latitude, longitude });
 	}
 
 	void AddStopDistance(transport_catalogue::TransportCatalogue& tc, const json::Dict& j_dict){
-		const string from_stop_name = j_dict.at("name"s).AsString();
+		const string& from_stop_name = j_dict.at("name"s).AsString();
 		const transport_catalogue::Stop* from_ptr = tc.GetStopByName(from_stop_name);
 		if (from_ptr != nullptr){
-			const json::Dict stops = j_dict.at("road_distances"s).AsDict();
+			const json::Dict& stops = j_dict.at("road_distances"s).AsDict();
 			for (const auto& [to_stop_name, distance] : stops)
 			{
 				tc.AddDistance(from_ptr, tc.GetStopByName(to_stop_name), static_cast<size_t>(distance.AsInt()));
@@ -97,6 +341,12 @@ namespace json_reader{
 				new_route.stops.push_back(tmp_ptr);
 			}
 		}
+		const auto departures = j_dict.find("departures"s);
+		if (departures != j_dict.cend()){
+			for (const auto& departure : departures->second.AsArray()){
+				new_route.departures.push_back(departure.AsDouble());
+			}
+		}
 		tc.AddRoute(move(new_route));
 	}
     
@@ -148,123 +398,455 @@ namespace json_reader{
 		router::RouterSettings new_settings;
 		new_settings.bus_velocity = j_dict.at("bus_velocity").AsInt();
 		new_settings.bus_wait_time = j_dict.at("bus_wait_time").AsInt();
+		const auto router_engine_it = j_dict.find("router_engine"s);
+		if (router_engine_it != j_dict.cend()){
+			new_settings.router_engine = ReadRouterEngine(router_engine_it->second.AsString());
+		}
 		tr.ApplyRouterSettings(new_settings);
 	}
 
 	void ParseRawJSONQueries(transport_catalogue::RequestHandler& rh,router::TransportRouter& tr,
-		const json::Array& j_arr,ostream& output){
-		json::Array processed_queries;
+		const json::Array& j_arr,ostream& output, json::PrintMode mode, const string& matrix_directory){
+		MatrixFiles matrix_files{ matrix_directory, {} };
+		unordered_set<string> matrix_file_names;
 		for (const auto& query : j_arr){
 			const auto request_type = query.AsDict().find("type"s);
-			if (request_type != query.AsDict().cend()){
-				if (request_type->second.AsString() == "Stop"s){
-					processed_queries.emplace_back(ProcessStopQuery(rh, query.AsDict()));
-				}
-				else if (request_type->second.AsString() == "Bus"s){
-					processed_queries.emplace_back(ProcessBusQuery(rh, query.AsDict()));
-				}
-				else if (request_type->second.AsString() == "Map"s){
-					processed_queries.emplace_back(ProcessMapQuery(rh, query.AsDict()));
+			const auto file = query.AsDict().find("file"s);
+			if (request_type != query.AsDict().cend() && request_type->second.AsString() == "Matrix"s
+				&& file != query.AsDict().cend() && file->second.IsString()
+				&& !matrix_file_names.insert(file->second.AsString()).second){
+				matrix_files.conflicts.insert(file->second.AsString());
+			}
+		}
+		// Queries on the graph or the router need them built; the other ones don't pay for it.
+		const bool has_route_queries = any_of(j_arr.begin(), j_arr.end(), [](const json::Node& query){
+			const auto request_type = query.AsDict().find("type"s);
+			return request_type != query.AsDict().cend()
+				&& (request_type->second.AsString() == "Route"s || request_type->second.AsString() == "Matrix"s
+					|| request_type->second.AsString() == "Reachable"s);
+		});
+		if (has_route_queries){
+			tr.Build();
+		}
+		json::ArrayPrinter printer(output, mode);
+		const size_t threads_count = concurrency::ThreadPool::DefaultThreadsCount();
+		if (threads_count < 2){
+			string answer;
+			for (const auto& query : j_arr){
+				answer.clear();
+				json::Writer writer(answer, mode, json::INDENT_STEP);
+				if (ProcessQuery(rh, tr, query, writer, &matrix_files)){
+					printer.PrintRendered(answer);
 				}
-				else if (request_type->second.AsString() == "Route"s){
-					processed_queries.emplace_back(ProcessRouteQuery(tr, query.AsDict()));
+			}
+			printer.Finish();
+			return;
+		}
+
+		// Queries are answered in batches on the pool; a bounded window of batches is in flight
+		// and they are printed in the order of the queries. A batch is one buffer with the answers
+		// written one after another and the offsets where each of them ends.
+		struct AnswersBatch{
+			string buffer;
+			vector<size_t> ends;
+		};
+		constexpr size_t QUERIES_IN_BATCH = 16;
+		concurrency::ThreadPool thread_pool(threads_count);
+		const size_t max_batches_in_flight = 4 * threads_count;
+		deque<future<AnswersBatch>> batches;
+		auto print_first_batch = [&batches, &printer]{
+			const AnswersBatch batch = batches.front().get();
+			const string_view buffer = batch.buffer;
+			size_t begin = 0;
+			for (const size_t end : batch.ends){
+				printer.PrintRendered(buffer.substr(begin, end - begin));
+				begin = end;
+			}
+			batches.pop_front();
+		};
+		for (size_t begin = 0; begin < j_arr.size(); begin += QUERIES_IN_BATCH){
+			const size_t end = min(begin + QUERIES_IN_BATCH, j_arr.size());
+			batches.push_back(thread_pool.Submit([&rh, &tr, &j_arr, &matrix_files, begin, end, mode]{
+				AnswersBatch batch;
+				batch.ends.reserve(end - begin);
+				json::Writer writer(batch.buffer, mode, json::INDENT_STEP);
+				for (size_t i = begin; i < end; ++i){
+					if (ProcessQuery(rh, tr, j_arr[i], writer, &matrix_files)){
+						batch.ends.push_back(batch.buffer.size());
+					}
 				}
+				return batch;
+			}));
+			if (batches.size() == max_batches_in_flight){
+				print_first_batch();
 			}
 		}
-		json::Print(json::Document{ processed_queries }, output);
+		while (!batches.empty()){
+			print_first_batch();
+		}
+		printer.Finish();
 	}
 
-	const json::Node ProcessStopQuery(transport_catalogue::RequestHandler& rh, const json::Dict& j_dict){
-		const string stop_name = j_dict.at("name"s).AsString();
+	bool ProcessQuery(const transport_catalogue::RequestHandler& rh, const router::TransportRouter& tr,
+		const json::Node& query, json::Writer& writer, const MatrixFiles* matrix_files){
+		const auto request_type = query.AsDict().find("type"s);
+		if (request_type != query.AsDict().cend()){
+			if (request_type->second.AsString() == "Stop"s){
+				ProcessStopQuery(rh, query.AsDict(), writer);
+				return true;
+			}
+			else if (request_type->second.AsString() == "Bus"s){
+				ProcessBusQuery(rh, query.AsDict(), writer);
+				return true;
+			}
+			else if (request_type->second.AsString() == "Map"s){
+				ProcessMapQuery(rh, query.AsDict(), writer);
+				return true;
+			}
+			else if (request_type->second.AsString() == "Route"s){
+				ProcessRouteQuery(tr, query.AsDict(), writer);
+				return true;
+			}
+			else if (request_type->second.AsString() == "Matrix"s){
+				ProcessMatrixQuery(tr, query.AsDict(), writer, matrix_files);
+				return true;
+			}
+			else if (request_type->second.AsString() == "Reachable"s){
+				ProcessReachableQuery(tr, query.AsDict(), writer);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Answers are written with their keys sorted, as json::Print orders a json::Dict.
+	void ProcessStopQuery(const transport_catalogue::RequestHandler& rh, const json::Dict& j_dict, json::Writer& writer){
+		const string& stop_name = j_dict.at("name"s).AsString();
 		const auto stop_query_ptr = rh.GetBusesForStop(stop_name);
 
 		if (stop_query_ptr == nullptr){
-			return json::Builder{}
-				.StartDict()
-				.Key("request_id"s).Value(j_dict.at("id"s).AsInt())
-				.Key("error_message"s).Value("not found"s)
-				.EndDict()
-				.Build();
-		}
-		json::Array routes;
-		for (auto& bus : stop_query_ptr.value()->buses){
-			routes.push_back(string(bus));
-		}
-		return json::Builder{}
-			.StartDict()
-			.Key("buses"s).Value(routes)
-			.Key("request_id"s).Value(j_dict.at("id"s).AsInt())
-			.EndDict()
-			.Build();
-	}
-
-	const json::Node ProcessBusQuery(transport_catalogue::RequestHandler& rh, const json::Dict& j_dict){
-		const string route_name = j_dict.at("name"s).AsString();
+			writer.StartDict()
+				.Key("error_message"sv).Value("not found"sv)
+				.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+				.EndDict();
+			return;
+		}
+		auto routes = writer.StartDict().Key("buses"sv).StartArray();
+		for (auto& bus : stop_query_ptr->buses){
+			routes.Value(bus);
+		}
+		routes.EndArray()
+			.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+			.EndDict();
+	}
+
+	void ProcessBusQuery(const transport_catalogue::RequestHandler& rh, const json::Dict& j_dict, json::Writer& writer){
+		const string& route_name = j_dict.at("name"s).AsString();
 		const auto route_query_ptr = rh.GetRouteInfo(route_name);
 		if (route_query_ptr == nullptr){
-			return json::Builder{}
-				.StartDict()
-				.Key("request_id"s).Value(j_dict.at("id"s).AsInt())
-				.Key("error_message"s).Value("not found"s)
-				.EndDict()
-				.Build();
-		}
-		return json::Builder{}
-			.StartDict()
-			.Key("curvature"s).Value(route_query_ptr.value()->curvature)
-			.Key("request_id"s).Value(j_dict.at("id"s).AsInt())
-			.Key("route_length"s).Value(static_cast<int>(route_query_ptr.value()->meters_route_length))
-			.Key("stop_count"s).Value(static_cast<int>(route_query_ptr.value()->stops_on_route))
-			.Key("unique_stop_count"s).Value(static_cast<int>(route_query_ptr.value()->unique_stops))
-			.EndDict()
-			.Build();
-	}
-
-
-	const json::Node ProcessMapQuery(transport_catalogue::RequestHandler& rh, const json::Dict& j_dict){
-		svg::Document svg_map = rh.GetMapRender();
-		ostringstream os_stream;
-		svg_map.Render(os_stream);
-		return json::Builder{}
-			.StartDict()
-			.Key("map"s).Value(os_stream.str())
-			.Key("request_id"s).Value(j_dict.at("id"s).AsInt())
-			.EndDict()
-			.Build();
+			writer.StartDict()
+				.Key("error_message"sv).Value("not found"sv)
+				.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+				.EndDict();
+			return;
+		}
+		writer.StartDict()
+			.Key("curvature"sv).Value(route_query_ptr->curvature)
+			.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+			.Key("route_length"sv).Value(static_cast<int>(route_query_ptr->meters_route_length))
+			.Key("stop_count"sv).Value(static_cast<int>(route_query_ptr->stops_on_route))
+			.Key("unique_stop_count"sv).Value(static_cast<int>(route_query_ptr->unique_stops))
+			.EndDict();
+	}
+
+
+	void ProcessMapQuery(const transport_catalogue::RequestHandler& rh, const json::Dict& j_dict, json::Writer& writer){
+		writer.StartDict()
+			.Key("map"sv).Value(rh.GetRenderedMapJSON())
+			.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+			.EndDict();
 	}
     
-	const json::Node ProcessRouteQuery(router::TransportRouter& tr, const json::Dict& j_dict){
+	void ProcessRouteQuery(const router::TransportRouter& tr, const json::Dict& j_dict, json::Writer& writer){
+		if (j_dict.count("departure_time"s) > 0){
+			ProcessTimetableRouteQuery(tr, j_dict, writer);
+			return;
+		}
+		if (j_dict.count("alternatives"s) > 0){
+			ProcessAlternativeRoutesQuery(tr, j_dict, writer);
+			return;
+		}
 		auto route_data = tr.CalculateRoute(j_dict.at("from").AsString(), j_dict.at("to").AsString());
 		if (!route_data.founded){
-			return json::Builder{}.StartDict().Key("request_id").Value(j_dict.at("id").AsInt())
-				.Key("error_message").Value("not found")
-				.EndDict()
-				.Build();
+			writer.StartDict()
+				.Key("error_message"sv).Value("not found"sv)
+				.Key("request_id"sv).Value(j_dict.at("id").AsInt())
+				.EndDict();
+			return;
+		}
+		writer.StartDict().Key("items"sv);
+		WriteRouteItems(route_data, writer);
+		writer.Key("request_id"sv).Value(j_dict.at("id").AsInt())
+			.Key("total_time"sv).Value(route_data.total_time)
+			.EndDict();
+	}
+
+	void ProcessAlternativeRoutesQuery(const router::TransportRouter& tr, const json::Dict& j_dict, json::Writer& writer){
+		const int count = j_dict.at("alternatives"s).AsInt();
+		if (count < 1 || static_cast<size_t>(count) > router::MAX_ROUTE_ALTERNATIVES){
+			writer.StartDict()
+				.Key("error_message"sv).Value("alternatives must be from 1 to "s + to_string(router::MAX_ROUTE_ALTERNATIVES))
+				.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+				.EndDict();
+			return;
+		}
+		const auto routes = tr.CalculateRoutes(j_dict.at("from"s).AsString(), j_dict.at("to"s).AsString(), static_cast<size_t>(count));
+		if (routes.empty()){
+			writer.StartDict()
+				.Key("error_message"sv).Value("not found"sv)
+				.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+				.EndDict();
+			return;
+		}
+		writer.StartDict()
+			.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+			.Key("routes"sv).StartArray();
+		for (const auto& route_data : routes){
+			writer.StartDict().Key("items"sv);
+			WriteRouteItems(route_data, writer);
+			writer.Key("total_time"sv).Value(route_data.total_time)
+				.EndDict();
+		}
+		writer.EndArray()
+			.EndDict();
+	}
+
+	void ProcessTimetableRouteQuery(const router::TransportRouter& tr, const json::Dict& j_dict, json::Writer& writer){
+		if (j_dict.count("alternatives"s) > 0){
+			writer.StartDict()
+				.Key("error_message"sv).Value("alternatives are not supported with departure_time"sv)
+				.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+				.EndDict();
+			return;
+		}
+		const double departure_time = j_dict.at("departure_time"s).AsDouble();
+		const auto route_data = tr.CalculateTimetableRoute(j_dict.at("from"s).AsString(), j_dict.at("to"s).AsString(), departure_time);
+		if (!route_data.founded){
+			writer.StartDict()
+				.Key("error_message"sv).Value("not found"sv)
+				.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+				.EndDict();
+			return;
 		}
-		json::Array items;
+		writer.StartDict()
+			.Key("arrival_time"sv).Value(departure_time + route_data.total_time)
+			.Key("items"sv);
+		WriteRouteItems(route_data, writer);
+		writer.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+			.Key("total_time"sv).Value(route_data.total_time)
+			.EndDict();
+	}
+
+	void WriteRouteItems(const router::RouteData& route_data, json::Writer& writer){
+		auto items = writer.StartArray();
 		for (const auto& item : route_data.items){
-			json::Dict items_map;
 			if (item.type == graph::EdgeType::TRAVEL)
 			{
-				items_map["type"] = "Bus"s;
-				items_map["bus"] = item.edge_name;
-				items_map["span_count"] = item.span_count;
+				items.StartDict()
+					.Key("bus"sv).Value(item.edge_name)
+					.Key("span_count"sv).Value(item.span_count)
+					.Key("time"sv).Value(item.time)
+					.Key("type"sv).Value("Bus"sv)
+					.EndDict();
 			}
 			else if (item.type == graph::EdgeType::WAIT)
 			{
-				items_map["type"] = "Wait"s;
-				items_map["stop_name"] = item.edge_name;
+				items.StartDict()
+					.Key("stop_name"sv).Value(item.edge_name)
+					.Key("time"sv).Value(item.time)
+					.Key("type"sv).Value("Wait"sv)
+					.EndDict();
 			}
-			items_map["time"] = item.time;
-			items.push_back(items_map);
 		}
-		return json::Builder{}.StartDict().Key("request_id").Value(j_dict.at("id").AsInt())
-            .Key("total_time").Value(route_data.total_time)
-			.Key("items").Value(items)
-			.EndDict()
-			.Build();
+		items.EndArray();
 	}
-    const string ReadSerializationSettings(const json::Dict& j_dict){
-		return j_dict.at("file").AsString();
+
+	void ProcessMatrixQuery(const router::TransportRouter& tr, const json::Dict& j_dict, json::Writer& writer,
+		const MatrixFiles* matrix_files){
+		const auto file = j_dict.find("file"s);
+		if (file != j_dict.cend()){
+			if (const string_view error = CheckMatrixFile(file->second.AsString(), matrix_files); !error.empty()){
+				writer.StartDict()
+					.Key("error_message"sv).Value(error)
+					.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+					.EndDict();
+				return;
+			}
+		}
+		auto read_stops = [&j_dict](const string& key){
+			vector<string_view> stops;
+			for (const auto& stop : j_dict.at(key).AsArray()){
+				stops.push_back(stop.AsString());
+			}
+			return stops;
+		};
+		const auto travel_times = tr.CalculateTravelTimes(read_stops("from"s), read_stops("to"s));
+		if (!travel_times){
+			writer.StartDict()
+				.Key("error_message"sv).Value("not found"sv)
+				.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+				.EndDict();
+			return;
+		}
+		if (file != j_dict.cend()){
+			ofstream output(matrix_files->directory + '/' + file->second.AsString(), ios::binary);
+			if (output){
+				router::WriteTravelTimes(*travel_times, output);
+			}
+			if (!output){
+				writer.StartDict()
+					.Key("error_message"sv).Value("can't write file"sv)
+					.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+					.EndDict();
+				return;
+			}
+			writer.StartDict()
+				.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+				.EndDict();
+			return;
+		}
+		auto rows = writer.StartDict()
+			.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+			.Key("times"sv).StartArray();
+		for (size_t row = 0; row < travel_times->rows; ++row){
+			auto times = rows.StartArray();
+			for (size_t column = 0; column < travel_times->columns; ++column){
+				const auto& time = travel_times->times[row * travel_times->columns + column];
+				if (time){
+					times.Value(*time);
+				}
+				else{
+					times.Value(nullptr);
+				}
+			}
+			times.EndArray();
+		}
+		rows.EndArray().EndDict();
+	}
+
+	string_view CheckMatrixFile(const string& name, const MatrixFiles* matrix_files){
+		if (matrix_files == nullptr || matrix_files->directory.empty()){
+			return "file output is not allowed"sv;
+		}
+		// Plain names only, so that a request can't write outside the directory.
+		if (name.empty() || name.find_first_of("/\\"s) != string::npos || name.find(".."s) != string::npos){
+			return "bad file name"sv;
+		}
+		if (matrix_files->conflicts.count(name) > 0){
+			return "file is written by several requests"sv;
+		}
+		return {};
+	}
+
+	void ProcessReachableQuery(const router::TransportRouter& tr, const json::Dict& j_dict, json::Writer& writer){
+		const auto reachable = tr.CalculateReachable(j_dict.at("from"s).AsString(), j_dict.at("max_time"s).AsDouble());
+		if (!reachable){
+			writer.StartDict()
+				.Key("error_message"sv).Value("not found"sv)
+				.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+				.EndDict();
+			return;
+		}
+		auto stops = writer.StartDict()
+			.Key("request_id"sv).Value(j_dict.at("id"s).AsInt())
+			.Key("stops"sv).StartArray();
+		for (const auto& stop : *reachable){
+			stops.StartDict()
+				.Key("stop_name"sv).Value(stop.stop_name)
+				.Key("time"sv).Value(stop.time)
+				.EndDict();
+		}
+		stops.EndArray().EndDict();
+	}
+	router::RouterEngine ReadRouterEngine(const string& engine_name){
+		if (engine_name == "floyd_warshall"s){
+			return router::RouterEngine::FLOYD_WARSHALL;
+		}
+		else if (engine_name == "dijkstra"s){
+			return router::RouterEngine::DIJKSTRA;
+		}
+		else if (engine_name == "contraction_hierarchies"s){
+			return router::RouterEngine::CONTRACTION_HIERARCHIES;
+		}
+		throw invalid_argument("Unknown router engine: "s + engine_name);
+	}
+
+	server::ServerSettings ReadServerSettings(const json::Dict& j_dict){
+		server::ServerSettings settings;
+		if (const auto it = j_dict.find("unix_socket"s); it != j_dict.cend()){
+			settings.unix_socket = it->second.AsString();
+		}
+		if (const auto it = j_dict.find("port"s); it != j_dict.cend()){
+			const int port = it->second.AsInt();
+			if (port <= 0 || port > 65535){
+				throw invalid_argument("Wrong server port "s + to_string(port));
+			}
+			settings.port = static_cast<uint16_t>(port);
+		}
+		if (settings.unix_socket.empty() && settings.port == 0){
+			throw invalid_argument("server_settings need unix_socket or port");
+		}
+		if (const auto it = j_dict.find("threads"s); it != j_dict.cend()){
+			settings.threads_count = static_cast<size_t>(max(it->second.AsInt(), 1));
+		}
+		return settings;
+	}
+
+    const serialization::SerializationSettings ReadSerializationSettings(const json::Dict& j_dict){
+		serialization::SerializationSettings settings;
+		settings.file = j_dict.at("file").AsString();
+		const auto format_it = j_dict.find("format"s);
+		if (format_it != j_dict.cend()){
+			settings.format = ReadBaseFormat(format_it->second.AsString());
+		}
+		const auto store_map_it = j_dict.find("store_rendered_map"s);
+		if (store_map_it != j_dict.cend()){
+			settings.store_rendered_map = store_map_it->second.AsBool();
+		}
+		return settings;
+	}
+
+	serialization::BaseFormat ReadBaseFormat(const string& format_name){
+		if (format_name == "protobuf"s){
+			return serialization::BaseFormat::PROTOBUF;
+		}
+		else if (format_name == "flat"s){
+			return serialization::BaseFormat::FLAT;
+		}
+		throw invalid_argument("Unknown base format: "s + format_name);
+	}
+
+	string ReadMatrixDirectory(const json::Dict& j_dict){
+		const auto output_settings_it = j_dict.find("output_settings"s);
+		if (output_settings_it == j_dict.cend()){
+			return {};
+		}
+		const auto directory_it = output_settings_it->second.AsDict().find("matrix_directory"s);
+		if (directory_it == output_settings_it->second.AsDict().cend()){
+			return {};
+		}
+		return directory_it->second.AsString();
+	}
+
+	json::PrintMode ReadOutputSettings(const json::Dict& j_dict){
+		const auto output_settings_it = j_dict.find("output_settings"s);
+		if (output_settings_it == j_dict.cend()){
+			return json::PrintMode::INDENTED;
+		}
+		const auto compact_it = output_settings_it->second.AsDict().find("compact"s);
+		if (compact_it != output_settings_it->second.AsDict().cend() && compact_it->second.AsBool()){
+			return json::PrintMode::COMPACT;
+		}
+		return json::PrintMode::INDENTED;
 	}
 }  
\ No newline at end of file
@@ -3,17 +3,95 @@
 #include "request_handler.h"        
 #include "json_builder.h"
 #include "json.h"
+#include "json_writer.h"
 #include "map_renderer.h"
+#include "query_server.h"
 #include "transport_router.h"
 #include "serialization.h"
+#include "thread_pool.h"
 
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <fstream>
+#include <future>
 #include <iostream>                  
+#include <optional>
 #include <sstream>                   
+#include <string>
+#include <string_view>
+#include <unordered_set>
 #include <vector>                    
 
 namespace json_reader{
+// Where the Matrix requests of a process_requests batch may write their "file". Requests from
+// serve and listen clients have none, so they can't write files.
+struct MatrixFiles{
+    // The files are written to this directory only; empty forbids them.
+    std::string directory;
+    // Names that several requests of the batch write at once; such requests are rejected.
+    std::unordered_set<std::string> conflicts;
+};
+
+// Adds base_requests to the catalogue while they are parsed, one element at a time.
+// Distances and buses that refer to stops further in the array wait until its end.
+// Other sections of the document are kept as nodes.
+class BaseJSONHandler final : public json::Handler{
+public:
+    explicit BaseJSONHandler(transport_catalogue::TransportCatalogue&);
+    void StartDict() override;
+    void Key(std::string_view) override;
+    void EndDict() override;
+    void StartArray() override;
+    void EndArray() override;
+    void String(std::string_view) override;
+    void Value(json::Node) override;
+
+    const json::Dict& GetSettings() const;
+private:
+    struct PendingDistance{
+        const transport_catalogue::Stop* from;
+        std::string to;
+        size_t distance;
+    };
+
+    void CompleteNode();
+    void AddBaseRequest(json::Node);
+    void AddPendingRequests();
+
+    transport_catalogue::TransportCatalogue& tc_;
+    json::NodeHandler node_handler_;
+    json::Dict settings_;
+    std::string section_;
+    int depth_ = 0;
+    bool building_node_ = false;
+    bool in_base_requests_ = false;
+    std::vector<PendingDistance> pending_distances_;
+    std::vector<json::Node> pending_buses_;
+};
+
 void ProcessBaseJSON(transport_catalogue::TransportCatalogue&, map_renderer::MapRenderer&, std::istream&);
+void ProcessBaseJSON(transport_catalogue::TransportCatalogue&, map_renderer::MapRenderer&, std::string_view);
+void ProcessBaseSettings(transport_catalogue::TransportCatalogue&, map_renderer::MapRenderer&, const json::Dict&);
 void ProcessRequestJSON(transport_catalogue::TransportCatalogue&, map_renderer::MapRenderer&, std::istream&, std::ostream&);
+void ProcessRequestJSON(transport_catalogue::TransportCatalogue&, map_renderer::MapRenderer&, std::string_view, std::ostream&);
+void ProcessRequests(transport_catalogue::TransportCatalogue&, map_renderer::MapRenderer&, const json::Dict&, std::ostream&);
+// Loads the base named by the serialization_settings of the settings document once, then answers
+// stat requests read one per line, each with one line of compact JSON, until the input ends.
+void ServeRequestJSON(transport_catalogue::TransportCatalogue&, map_renderer::MapRenderer&, std::string_view settings,
+    std::istream& queries, std::ostream& output);
+void ServeRequests(transport_catalogue::TransportCatalogue&, map_renderer::MapRenderer&, const json::Dict& settings,
+    std::istream& queries, std::ostream& output);
+// Loads the base like ServeRequests and answers the same lines from the clients of a local socket
+// described by server_settings, until SIGINT or SIGTERM.
+void ListenRequests(transport_catalogue::TransportCatalogue&, map_renderer::MapRenderer&, const json::Dict& settings);
+// Reads the base named by serialization_settings of the document into the catalogue, the renderer and the router
+// and builds what the base does not store, so that the router is complete before the first query.
+void LoadBase(transport_catalogue::TransportCatalogue&, map_renderer::MapRenderer&, router::TransportRouter&, const json::Dict& settings);
+bool IsBlankLine(std::string_view);
+// Appends the answer to one query line as a line of compact JSON; errors are answered with error_message.
+void AnswerQueryLine(const transport_catalogue::RequestHandler&, const router::TransportRouter&, std::string_view line,
+    std::string& answer);
 
 void AddToDataBase(transport_catalogue::TransportCatalogue&, const json::Array&);
 void AddStopData(transport_catalogue::TransportCatalogue&, const json::Dict&);
@@ -23,11 +101,37 @@ void AddRouteData(transport_catalogue::TransportCatalogue&, const json::Dict&);
 const svg::Color ConvertJSONColorToSVG(const json::Node&);
 void ReadRendererSettings(map_renderer::MapRenderer&, const json::Dict&);
 void ReadRouterSettings(router::TransportRouter&, const json::Dict&);
-const std::string ReadSerializationSettings(const json::Dict&);
+router::RouterEngine ReadRouterEngine(const std::string&);
+const serialization::SerializationSettings ReadSerializationSettings(const json::Dict&);
+// Reads server_settings: unix_socket (a path) or port (a loopback TCP port), and threads.
+server::ServerSettings ReadServerSettings(const json::Dict&);
+serialization::BaseFormat ReadBaseFormat(const std::string&);
+// Reads output_settings of the document: {"compact": true} prints the answers without whitespace.
+json::PrintMode ReadOutputSettings(const json::Dict&);
+// Reads "matrix_directory" of output_settings, the directory for the files of Matrix requests.
+std::string ReadMatrixDirectory(const json::Dict&);
 
-void ParseRawJSONQueries(transport_catalogue::RequestHandler&, router::TransportRouter&, const json::Array&, std::ostream&);
-const json::Node ProcessStopQuery(transport_catalogue::RequestHandler&, const json::Dict&);
-const json::Node ProcessBusQuery(transport_catalogue::RequestHandler&, const json::Dict&);
-const json::Node ProcessMapQuery(transport_catalogue::RequestHandler&, const json::Dict&);
-const json::Node ProcessRouteQuery(router::TransportRouter&, const json::Dict&);
+// Answers the queries on all cores and prints the answers in the order of the queries.
+// Matrix requests may write files to matrix_directory only.
+void ParseRawJSONQueries(transport_catalogue::RequestHandler&, router::TransportRouter&, const json::Array&, std::ostream&,
+    json::PrintMode = json::PrintMode::INDENTED, const std::string& matrix_directory = {});
+// Writes the answer to the query and returns true, or returns false for an unknown query type.
+bool ProcessQuery(const transport_catalogue::RequestHandler&, const router::TransportRouter&, const json::Node&, json::Writer&,
+    const MatrixFiles* = nullptr);
+void ProcessStopQuery(const transport_catalogue::RequestHandler&, const json::Dict&, json::Writer&);
+void ProcessBusQuery(const transport_catalogue::RequestHandler&, const json::Dict&, json::Writer&);
+void ProcessMapQuery(const transport_catalogue::RequestHandler&, const json::Dict&, json::Writer&);
+void ProcessRouteQuery(const router::TransportRouter&, const json::Dict&, json::Writer&);
+// A Route request with "alternatives": up to that many routes, the best first.
+void ProcessAlternativeRoutesQuery(const router::TransportRouter&, const json::Dict&, json::Writer&);
+// A Route request with "departure_time": the earliest arrival by the timetables of the buses.
+void ProcessTimetableRouteQuery(const router::TransportRouter&, const json::Dict&, json::Writer&);
+// The "items" array of a route answer.
+void WriteRouteItems(const router::RouteData&, json::Writer&);
+// Answers total times from every stop of "from" to every stop of "to", or writes them to "file" when it is given.
+void ProcessMatrixQuery(const router::TransportRouter&, const json::Dict&, json::Writer&, const MatrixFiles* = nullptr);
+// The reason to reject the "file" of a Matrix request, or an empty string if it may be written.
+std::string_view CheckMatrixFile(const std::string& name, const MatrixFiles*);
+// Answers the stops reachable from "from" within "max_time" minutes with their arrival times.
+void ProcessReachableQuery(const router::TransportRouter&, const json::Dict&, json::Writer&);
 }
\ No newline at end of file
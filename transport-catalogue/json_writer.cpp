@@ -0,0 +1,166 @@
+#include "json_writer.h"
+
+#include <charconv>
+#include <stdexcept>
+using namespace std;
+namespace json{
+
+void AppendEscapedString(string& buffer, string_view value){
+    buffer += '"';
+    for (const char c : value){
+        switch (c){
+        case '\r':
+            buffer += "\\r"sv;
+            break;
+        case '\n':
+            buffer += "\\n"sv;
+            break;
+        case '"':
+            [[fallthrough]];
+        case '\\':
+            buffer += '\\';
+            [[fallthrough]];
+        default:
+            buffer += c;
+            break;
+        }
+    }
+    buffer += '"';
+}
+
+Writer::Writer(string& buffer, PrintMode mode, int indent)
+    : buffer_(buffer), mode_(mode), indent_(indent)
+{}
+
+Writer::KeyContext Writer::Key(string_view key){
+    if (levels_.empty() || !levels_.back().is_dict){
+        throw logic_error("Key() called outside of a Dict.");
+    }
+    if (key_opened_){
+        throw logic_error("Key() called for a Dict with already setted Key. Should call Value()");
+    }
+    BeginElement(levels_.back());
+    AppendEscapedString(buffer_, key);
+    buffer_ += mode_ == PrintMode::COMPACT ? ":"sv : ": "sv;
+    key_opened_ = true;
+    return KeyContext{ *this };
+}
+
+Writer::BaseContext Writer::Value(nullptr_t){
+    BeginValue();
+    buffer_ += "null"sv;
+    return BaseContext{ *this };
+}
+
+Writer::BaseContext Writer::Value(bool value){
+    BeginValue();
+    buffer_ += value ? "true"sv : "false"sv;
+    return BaseContext{ *this };
+}
+
+Writer::BaseContext Writer::Value(int value){
+    BeginValue();
+    char digits[16];
+    const auto result = to_chars(begin(digits), end(digits), value);
+    buffer_.append(digits, result.ptr);
+    return BaseContext{ *this };
+}
+
+Writer::BaseContext Writer::Value(double value){
+    BeginValue();
+    // The same as operator<< with the default stream precision, i.e. %g.
+    char digits[32];
+    const auto result = to_chars(begin(digits), end(digits), value, chars_format::general, 6);
+    buffer_.append(digits, result.ptr);
+    return BaseContext{ *this };
+}
+
+Writer::BaseContext Writer::Value(string_view value){
+    BeginValue();
+    AppendEscapedString(buffer_, value);
+    return BaseContext{ *this };
+}
+
+Writer::BaseContext Writer::Value(const char* value){
+    return Value(string_view(value));
+}
+
+Writer::BaseContext Writer::Value(EscapedString value){
+    BeginValue();
+    buffer_ += value.value;
+    return BaseContext{ *this };
+}
+
+Writer::DictItemContext Writer::StartDict(){
+    BeginValue();
+    buffer_ += '{';
+    levels_.push_back({ true, true });
+    return DictItemContext{ *this };
+}
+
+Writer::ArrayItemContext Writer::StartArray(){
+    BeginValue();
+    buffer_ += '[';
+    levels_.push_back({ false, true });
+    return ArrayItemContext{ *this };
+}
+
+Writer::BaseContext Writer::EndDict(){
+    if (levels_.empty() || !levels_.back().is_dict || key_opened_){
+        throw logic_error("EndDict() called at wrong order.");
+    }
+    EndContainer(true);
+    return BaseContext{ *this };
+}
+
+Writer::BaseContext Writer::EndArray(){
+    if (levels_.empty() || levels_.back().is_dict){
+        throw logic_error("EndArray() called at wrong order.");
+    }
+    EndContainer(false);
+    return BaseContext{ *this };
+}
+
+void Writer::BeginValue(){
+    if (levels_.empty()){
+        return;
+    }
+    Level& level = levels_.back();
+    if (!level.is_dict){
+        BeginElement(level);
+    }
+    else if (key_opened_){
+        key_opened_ = false;
+    }
+    else{
+        throw logic_error("Value() called for Dict' Key field, not for Value field as intended.");
+    }
+}
+
+void Writer::BeginElement(Level& level){
+    if (!level.empty){
+        buffer_ += ',';
+    }
+    level.empty = false;
+    AppendLineBreak(static_cast<int>(levels_.size()));
+}
+
+void Writer::EndContainer(bool is_dict){
+    const bool empty = levels_.back().empty;
+    levels_.pop_back();
+    if (empty && mode_ != PrintMode::COMPACT){
+        buffer_ += '\n';
+    }
+    AppendLineBreak(static_cast<int>(levels_.size()));
+    buffer_ += is_dict ? '}' : ']';
+}
+
+void Writer::AppendLineBreak(int depth){
+    if (mode_ == PrintMode::COMPACT){
+        return;
+    }
+    buffer_ += '\n';
+    buffer_.append(indent_ + depth * INDENT_STEP, ' ');
+}
+
+}
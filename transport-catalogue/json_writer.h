@@ -0,0 +1,140 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace json{
+
+// Appends the value as a quoted JSON string, escaped the same way as json::Print does.
+void AppendEscapedString(std::string& buffer, std::string_view value);
+
+// A string that is already quoted and escaped, e.g. by AppendEscapedString. Writer copies it as is,
+// which lets a long string that is answered many times be escaped only once.
+struct EscapedString{
+    std::string_view value;
+};
+
+// Serializes JSON straight into a string without building a Node, with the same layout as
+// json::Print. The calls are chained like json::Builder's and the contexts reject a wrong
+// order at compile time. Keys are written in call order, so to match Print of a Dict they
+// should be written sorted. Several values can be written one after another into one buffer.
+class Writer{
+public:
+    class BaseContext;
+    class KeyContext;
+    class DictItemContext;
+    class ArrayItemContext;
+
+    // indent is the indentation of the line the first value starts on.
+    explicit Writer(std::string& buffer, PrintMode mode = PrintMode::INDENTED, int indent = 0);
+
+    KeyContext Key(std::string_view key);
+    BaseContext Value(std::nullptr_t);
+    BaseContext Value(bool value);
+    BaseContext Value(int value);
+    BaseContext Value(double value);
+    BaseContext Value(std::string_view value);
+    BaseContext Value(const char* value);
+    BaseContext Value(EscapedString value);
+    DictItemContext StartDict();
+    ArrayItemContext StartArray();
+    BaseContext EndDict();
+    BaseContext EndArray();
+private:
+    struct Level{
+        bool is_dict = false;
+        bool empty = true;
+    };
+
+    void BeginValue();
+    void BeginElement(Level& level);
+    void EndContainer(bool is_dict);
+    void AppendLineBreak(int depth);
+
+    std::string& buffer_;
+    PrintMode mode_;
+    int indent_;
+    std::vector<Level> levels_;
+    bool key_opened_ = false;
+};
+
+class Writer::BaseContext{
+public:
+    BaseContext(Writer& writer) : writer_(writer)
+    {}
+    KeyContext Key(std::string_view key);
+    template <typename T>
+    BaseContext Value(T&& value){
+        return writer_.Value(std::forward<T>(value));
+    }
+    DictItemContext StartDict();
+    ArrayItemContext StartArray();
+    BaseContext EndDict();
+    BaseContext EndArray();
+protected:
+    Writer& writer_;
+};
+
+class Writer::KeyContext : public BaseContext{
+public:
+    KeyContext(Writer& writer) : BaseContext(writer)
+    {}
+    template <typename T>
+    DictItemContext Value(T&& value);
+    KeyContext Key(std::string_view) = delete;
+    BaseContext EndDict() = delete;
+    BaseContext EndArray() = delete;
+};
+
+class Writer::DictItemContext : public BaseContext{
+public:
+    DictItemContext(Writer& writer) : BaseContext(writer)
+    {}
+    template <typename T>
+    BaseContext Value(T&&) = delete;
+    DictItemContext StartDict() = delete;
+    ArrayItemContext StartArray() = delete;
+    BaseContext EndArray() = delete;
+};
+
+class Writer::ArrayItemContext : public BaseContext{
+public:
+    ArrayItemContext(Writer& writer) : BaseContext(writer)
+    {}
+    template <typename T>
+    ArrayItemContext Value(T&& value){
+        writer_.Value(std::forward<T>(value));
+        return ArrayItemContext{ writer_ };
+    }
+    KeyContext Key(std::string_view) = delete;
+    BaseContext EndDict() = delete;
+};
+
+template <typename T>
+Writer::DictItemContext Writer::KeyContext::Value(T&& value){
+    writer_.Value(std::forward<T>(value));
+    return DictItemContext{ writer_ };
+}
+
+inline Writer::KeyContext Writer::BaseContext::Key(std::string_view key){
+    return writer_.Key(key);
+}
+inline Writer::DictItemContext Writer::BaseContext::StartDict(){
+    return writer_.StartDict();
+}
+inline Writer::ArrayItemContext Writer::BaseContext::StartArray(){
+    return writer_.StartArray();
+}
+inline Writer::BaseContext Writer::BaseContext::EndDict(){
+    return writer_.EndDict();
+}
+inline Writer::BaseContext Writer::BaseContext::EndArray(){
+    return writer_.EndArray();
+}
+
+}
@@ -0,0 +1,273 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+#include "dijkstra_router.h"
+#include "ranges.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace graph{
+    // Ids of the edges that end in every vertex, in compressed rows: the edges into vertex v are
+    // edge_ids[offsets[v]] .. edge_ids[offsets[v + 1] - 1].
+    struct IncomingEdges{
+        std::vector<size_t> offsets;
+        std::vector<EdgeId> edge_ids;
+
+        ranges::Range<std::vector<EdgeId>::const_iterator> Get(VertexId vertex) const{
+            return { edge_ids.begin() + offsets[vertex], edge_ids.begin() + offsets[vertex + 1] };
+        }
+    };
+
+    template <typename Weight>
+    IncomingEdges BuildIncomingEdges(const DirectedWeightedGraph<Weight>& graph){
+        IncomingEdges incoming;
+        incoming.offsets.assign(graph.GetVertexCount() + 1, 0);
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id){
+            ++incoming.offsets[graph.GetEdge(edge_id).to + 1];
+        }
+        for (VertexId vertex = 0; vertex < graph.GetVertexCount(); ++vertex){
+            incoming.offsets[vertex + 1] += incoming.offsets[vertex];
+        }
+        incoming.edge_ids.resize(graph.GetEdgeCount());
+        std::vector<size_t> next = incoming.offsets;
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id){
+            incoming.edge_ids[next[graph.GetEdge(edge_id).to]++] = edge_id;
+        }
+        return incoming;
+    }
+
+    // Loopless paths from one vertex to another in the order of their weights (Yen's algorithm).
+    // Every spur search is an A* guided by the exact distances to the target in the whole graph.
+    // They come from one backward search that is shared by all spur searches and only goes as
+    // far as they ask, so a spur search mostly walks straight to the target.
+    template <typename Weight>
+    class KShortestPaths{
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+    public:
+        using RouteInfo = graph::RouteInfo<Weight>;
+
+        KShortestPaths(const Graph& graph, const IncomingEdges& incoming_edges, VertexId from, VertexId to);
+        // The next path, or nullopt when there are no more.
+        std::optional<RouteInfo> Next();
+    private:
+        enum class VertexState : char{
+            UNREACHED,
+            REACHED,
+            SETTLED,
+        };
+        using QueueItem = std::pair<Weight, VertexId>;
+        using Queue = std::vector<QueueItem>;
+
+        std::optional<Weight> GetDistanceToTarget(VertexId vertex);
+        // The best path from start to the target that avoids the blocked vertices and edges.
+        std::optional<RouteInfo> SearchSpur(VertexId start);
+        void AddSpurPaths(const RouteInfo& last_path);
+
+        static void Push(Queue& queue, Weight weight, VertexId vertex){
+            queue.emplace_back(weight, vertex);
+            std::push_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+        }
+        static QueueItem Pop(Queue& queue){
+            std::pop_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+            const QueueItem item = queue.back();
+            queue.pop_back();
+            return item;
+        }
+
+        static constexpr Weight ZERO_WEIGHT{};
+        const Graph& graph_;
+        const IncomingEdges& incoming_edges_;
+        VertexId from_;
+        VertexId to_;
+
+        // The backward search from the target.
+        std::vector<Weight> distances_to_target_;
+        std::vector<VertexState> backward_states_;
+        Queue backward_queue_;
+
+        // Buffers of the spur searches; touched_ lists the vertices to reset.
+        std::vector<Weight> weights_;
+        std::vector<EdgeId> prev_edges_;
+        std::vector<VertexState> states_;
+        std::vector<VertexId> touched_;
+        std::vector<bool> blocked_vertexes_;
+        std::unordered_set<EdgeId> blocked_edges_;
+
+        std::vector<RouteInfo> paths_;
+        // Candidates ordered by the weight, the edges break ties.
+        std::set<std::pair<Weight, std::vector<EdgeId>>> candidates_;
+        std::set<std::vector<EdgeId>> known_paths_;
+        bool exhausted_ = false;
+    };
+
+    template <typename Weight>
+    KShortestPaths<Weight>::KShortestPaths(const Graph& graph, const IncomingEdges& incoming_edges, VertexId from, VertexId to)
+        : graph_(graph)
+        , incoming_edges_(incoming_edges)
+        , from_(from)
+        , to_(to)
+        , distances_to_target_(graph.GetVertexCount())
+        , backward_states_(graph.GetVertexCount(), VertexState::UNREACHED)
+        , weights_(graph.GetVertexCount())
+        , prev_edges_(graph.GetVertexCount(), NO_EDGE)
+        , states_(graph.GetVertexCount(), VertexState::UNREACHED)
+        , blocked_vertexes_(graph.GetVertexCount(), false)
+    {
+        if (from >= graph.GetVertexCount() || to >= graph.GetVertexCount()){
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        distances_to_target_[to] = ZERO_WEIGHT;
+        backward_states_[to] = VertexState::REACHED;
+        Push(backward_queue_, ZERO_WEIGHT, to);
+    }
+
+    template <typename Weight>
+    std::optional<typename KShortestPaths<Weight>::RouteInfo> KShortestPaths<Weight>::Next(){
+        if (exhausted_){
+            return std::nullopt;
+        }
+        if (paths_.empty()){
+            auto path = SearchSpur(from_);
+            if (path){
+                known_paths_.insert(path->edges);
+                paths_.push_back(std::move(*path));
+                return paths_.back();
+            }
+            exhausted_ = true;
+            return std::nullopt;
+        }
+        AddSpurPaths(paths_.back());
+        if (candidates_.empty()){
+            exhausted_ = true;
+            return std::nullopt;
+        }
+        auto best = candidates_.extract(candidates_.begin());
+        paths_.push_back(RouteInfo{ best.value().first, std::move(best.value().second) });
+        return paths_.back();
+    }
+
+    template <typename Weight>
+    void KShortestPaths<Weight>::AddSpurPaths(const RouteInfo& last_path){
+        const std::vector<EdgeId>& edges = last_path.edges;
+        Weight root_weight = ZERO_WEIGHT;
+        VertexId spur_vertex = from_;
+        for (size_t spur_index = 0; spur_index < edges.size(); ++spur_index){
+            // Paths with the same root can't leave it by the edges they already use,
+            // and the root vertices before the spur vertex are not visited again.
+            blocked_edges_.clear();
+            for (const RouteInfo& path : paths_){
+                if (path.edges.size() > spur_index && std::equal(edges.begin(), edges.begin() + spur_index, path.edges.begin())){
+                    blocked_edges_.insert(path.edges[spur_index]);
+                }
+            }
+            if (auto spur_path = SearchSpur(spur_vertex)){
+                std::vector<EdgeId> candidate_edges(edges.begin(), edges.begin() + spur_index);
+                candidate_edges.insert(candidate_edges.end(), spur_path->edges.begin(), spur_path->edges.end());
+                if (known_paths_.insert(candidate_edges).second){
+                    candidates_.emplace(root_weight + spur_path->weight, std::move(candidate_edges));
+                }
+            }
+            blocked_vertexes_[spur_vertex] = true;
+            const auto& edge = graph_.GetEdge(edges[spur_index]);
+            root_weight += edge.weight;
+            spur_vertex = edge.to;
+        }
+        VertexId vertex = from_;
+        blocked_vertexes_[vertex] = false;
+        for (const EdgeId edge_id : edges){
+            vertex = graph_.GetEdge(edge_id).to;
+            blocked_vertexes_[vertex] = false;
+        }
+    }
+
+    template <typename Weight>
+    std::optional<Weight> KShortestPaths<Weight>::GetDistanceToTarget(VertexId vertex){
+        while (backward_states_[vertex] != VertexState::SETTLED && !backward_queue_.empty()){
+            const auto [weight, current] = Pop(backward_queue_);
+            if (backward_states_[current] == VertexState::SETTLED){
+                continue;
+            }
+            backward_states_[current] = VertexState::SETTLED;
+            for (const EdgeId edge_id : incoming_edges_.Get(current)){
+                const auto& edge = graph_.GetEdge(edge_id);
+                const Weight candidate_weight = weight + edge.weight;
+                if (backward_states_[edge.from] == VertexState::UNREACHED
+                    || (backward_states_[edge.from] == VertexState::REACHED && candidate_weight < distances_to_target_[edge.from])){
+                    backward_states_[edge.from] = VertexState::REACHED;
+                    distances_to_target_[edge.from] = candidate_weight;
+                    Push(backward_queue_, candidate_weight, edge.from);
+                }
+            }
+        }
+        if (backward_states_[vertex] != VertexState::SETTLED){
+            return std::nullopt;
+        }
+        return distances_to_target_[vertex];
+    }
+
+    template <typename Weight>
+    std::optional<typename KShortestPaths<Weight>::RouteInfo> KShortestPaths<Weight>::SearchSpur(VertexId start){
+        for (const VertexId vertex : touched_){
+            states_[vertex] = VertexState::UNREACHED;
+        }
+        touched_.clear();
+        const auto start_estimate = GetDistanceToTarget(start);
+        if (!start_estimate){
+            return std::nullopt;
+        }
+        Queue queue;
+        weights_[start] = ZERO_WEIGHT;
+        prev_edges_[start] = NO_EDGE;
+        states_[start] = VertexState::REACHED;
+        touched_.push_back(start);
+        Push(queue, *start_estimate, start);
+        while (!queue.empty()){
+            const VertexId vertex = Pop(queue).second;
+            if (states_[vertex] == VertexState::SETTLED){
+                continue;
+            }
+            states_[vertex] = VertexState::SETTLED;
+            if (vertex == to_){
+                break;
+            }
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)){
+                const auto& edge = graph_.GetEdge(edge_id);
+                if (blocked_vertexes_[edge.to] || states_[edge.to] == VertexState::SETTLED || blocked_edges_.count(edge_id) > 0){
+                    continue;
+                }
+                const auto estimate = GetDistanceToTarget(edge.to);
+                if (!estimate){
+                    continue;
+                }
+                const Weight candidate_weight = weights_[vertex] + edge.weight;
+                if (states_[edge.to] == VertexState::UNREACHED || candidate_weight < weights_[edge.to]){
+                    if (states_[edge.to] == VertexState::UNREACHED){
+                        touched_.push_back(edge.to);
+                    }
+                    states_[edge.to] = VertexState::REACHED;
+                    weights_[edge.to] = candidate_weight;
+                    prev_edges_[edge.to] = edge_id;
+                    Push(queue, candidate_weight + *estimate, edge.to);
+                }
+            }
+        }
+        if (states_[to_] != VertexState::SETTLED){
+            return std::nullopt;
+        }
+        std::vector<EdgeId> edges;
+        for (VertexId vertex = to_; vertex != start; vertex = graph_.GetEdge(prev_edges_[vertex]).from){
+            edges.push_back(prev_edges_[vertex]);
+        }
+        std::reverse(edges.begin(), edges.end());
+        return RouteInfo{ weights_[to_], std::move(edges) };
+    }
+}
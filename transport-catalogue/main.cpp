@@ -1,32 +1,63 @@
 #include <iostream>             
 #include <fstream>              
+#include <memory>
+#include <string>
 #include <string_view>
 
 #include "request_handler.h"    
 #include "json_reader.h"        
 #include "json_builder.h"
 #include "map_renderer.h"
+#include "mapped_file.h"
 using namespace std;
 
 void PrintUsage(ostream& stream = cerr){
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|process_requests|serve|listen] [input.json]\n"sv;
 }
 
 int main(int argc, char* argv[]){
-    if (argc != 2){
+    if (argc != 2 && argc != 3){
         PrintUsage();
         return 1;
     }
     const string_view mode(argv[1]);
+    // The input file is mapped into memory and parsed in place; without it stdin is read.
+    const unique_ptr<io::MappedFile> input_file = argc == 3 ? make_unique<io::MappedFile>(argv[2]) : nullptr;
     if (mode == "make_base"sv){
         transport_catalogue::TransportCatalogue tc;
         map_renderer::MapRenderer mr;
-        json_reader::ProcessBaseJSON(tc, mr, cin);
+        if (input_file){
+            json_reader::ProcessBaseJSON(tc, mr, input_file->GetContents());
+        }
+        else{
+            json_reader::ProcessBaseJSON(tc, mr, cin);
+        }
     }
     else if (mode == "process_requests"sv){
         transport_catalogue::TransportCatalogue tc;
         map_renderer::MapRenderer mr;
-        json_reader::ProcessRequestJSON(tc, mr, cin, cout);
+        if (input_file){
+            json_reader::ProcessRequestJSON(tc, mr, input_file->GetContents(), cout);
+        }
+        else{
+            json_reader::ProcessRequestJSON(tc, mr, cin, cout);
+        }
+    }
+    else if (mode == "serve"sv){
+        transport_catalogue::TransportCatalogue tc;
+        map_renderer::MapRenderer mr;
+        // Without an input file the first line of stdin holds the settings, the next ones the queries.
+        string settings_line;
+        if (!input_file){
+            getline(cin, settings_line);
+        }
+        json_reader::ServeRequestJSON(tc, mr, input_file ? input_file->GetContents() : string_view(settings_line), cin, cout);
+    }
+    else if (mode == "listen"sv){
+        transport_catalogue::TransportCatalogue tc;
+        map_renderer::MapRenderer mr;
+        const json::Document settings = input_file ? json::Load(input_file->GetContents()) : json::Load(cin);
+        json_reader::ListenRequests(tc, mr, settings.GetRoot().AsDict());
     }
     else{
         PrintUsage();
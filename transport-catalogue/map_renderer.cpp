@@ -31,7 +31,7 @@ namespace map_renderer{
 	}
 
 	TextLabel::TextLabel(const svg::Point& label_point,
-		const string& text,
+		string_view text,
 		const svg::Color& fill_fore_color,
 		const RendererSettings& renderer_settings,
 		const bool& is_stop) :
@@ -43,7 +43,7 @@ namespace map_renderer{
 		svg::Text fore_text;
 		fore_text.SetPosition(label_point_);
 		fore_text.SetFontFamily("Verdana"s);
-		fore_text.SetData(text_);
+		fore_text.SetData(string(text_));
 		if (is_stop_){
 			fore_text.SetOffset(renderer_settings_.stop_label_offset);
 			fore_text.SetFontSize(renderer_settings_.stop_label_font_size);
@@ -81,30 +81,40 @@ namespace map_renderer{
 
 	void MapRenderer::ApplyRendererSettings(RendererSettings settings){
 		settings_ = settings;
+		rendered_map_.reset();
 	}
 
 	RendererSettings MapRenderer::GetRendererSettings() const{
 		return settings_;
 	}
 
+	void MapRenderer::ApplyRenderedMap(string rendered_map){
+		rendered_map_ = move(rendered_map);
+	}
+
+	const optional<string>& MapRenderer::GetRenderedMap() const{
+		return rendered_map_;
+	}
+
 	void MapRenderer::AddRouteLinesToRender(vector<unique_ptr<svg::Drawable>>& picture_,
 		SphereProjector& sp,
-		map<const string, transport_catalogue::RendererData>& routes_to_render){
+		map<string_view, transport_catalogue::RendererData>& routes_to_render) const{
+		size_t pallette_item = 0;
 		for (const auto& [name, data] : routes_to_render){
 			std::vector<svg::Point> points;
 			for (const auto& stop : data.stop_coords){
 				points.push_back(sp(stop));
 			}
-			picture_.emplace_back(std::make_unique<RouteLine>(RouteLine{ points, GetColorFromPallete() , settings_ }));
+			picture_.emplace_back(std::make_unique<RouteLine>(RouteLine{ points, GetColorFromPallete(pallette_item) , settings_ }));
 		}
 	}
 
 	void MapRenderer::AddRouteLabelsToRender(vector<unique_ptr<svg::Drawable>>& picture_,
 		SphereProjector& sp,
-		map<const string, transport_catalogue::RendererData>& routes_to_render){
-		ResetPallette();
+		map<string_view, transport_catalogue::RendererData>& routes_to_render) const{
+		size_t pallette_item = 0;
 		for (const auto& [name, data] : routes_to_render){
-			svg::Color current_line_color = GetColorFromPallete();
+			svg::Color current_line_color = GetColorFromPallete(pallette_item);
 			picture_.emplace_back(make_unique<TextLabel>(TextLabel{ sp(data.stop_coords[0]),
 															  name,
 															  current_line_color,
@@ -120,7 +130,7 @@ namespace map_renderer{
 
 	void MapRenderer::AddStopLabelsToRender(vector<unique_ptr<svg::Drawable>>& picture_,
 		SphereProjector& sp,
-		map<string_view, geo::Coordinates> all_unique_stops){
+		map<string_view, geo::Coordinates> all_unique_stops) const{
 		for (const auto& stop : all_unique_stops){
 			picture_.emplace_back(make_unique<StopIcon>(StopIcon{ sp(stop.second), settings_ }));
 		}
@@ -128,13 +138,13 @@ namespace map_renderer{
 
 	void MapRenderer::AddStopIconsToRender(vector<unique_ptr<svg::Drawable>>& picture_,
 		SphereProjector& sp,
-		map<string_view, geo::Coordinates> all_unique_stops){
+		map<string_view, geo::Coordinates> all_unique_stops) const{
 		for (const auto& stop : all_unique_stops){
-			picture_.emplace_back(make_unique<TextLabel>(TextLabel{sp(stop.second),string(stop.first),"black"s,settings_,true }));
+			picture_.emplace_back(make_unique<TextLabel>(TextLabel{sp(stop.second),stop.first,"black"s,settings_,true }));
 		}
 	}
 
-	svg::Document MapRenderer::RenderMap(map<const string, transport_catalogue::RendererData>& routes_to_render){
+	svg::Document MapRenderer::RenderMap(map<string_view, transport_catalogue::RendererData>& routes_to_render) const{
 		unordered_set<geo::Coordinates, geo::CoordinatesHasher> all_coords;
 		map<std::string_view, geo::Coordinates> all_unique_stops;
 		for (const auto& [name, data] : routes_to_render){
@@ -156,14 +166,10 @@ namespace map_renderer{
 		return map;
 	}
 
-	const svg::Color MapRenderer::GetColorFromPallete(){
-		if (pallette_item_ == settings_.color_palette.size()){
-			pallette_item_ = 0;
+	const svg::Color MapRenderer::GetColorFromPallete(size_t& pallette_item) const{
+		if (pallette_item == settings_.color_palette.size()){
+			pallette_item = 0;
 		}
-		return settings_.color_palette[pallette_item_++];
-	}
-
-	void MapRenderer::ResetPallette(){
-		pallette_item_ = 0;
+		return settings_.color_palette[pallette_item++];
 	}
 }
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include <vector>
 #include <cmath>
 #include <map>            
+#include <optional>
         
 namespace map_renderer{
     struct RendererSettings{
@@ -90,13 +91,13 @@ namespace map_renderer{
 
     class TextLabel : public svg::Drawable{
     public:
-        TextLabel(const svg::Point&, const std::string& text, const svg::Color&, const RendererSettings&, const bool& is_stop);
+        TextLabel(const svg::Point&, std::string_view text, const svg::Color&, const RendererSettings&, const bool& is_stop);
         void Draw(svg::ObjectContainer&) const override;
     private:
         svg::Point label_point_;
         std::string font_family_;
         std::string font_weight_;
-        std::string text_;
+        std::string_view text_;
         svg::Color fill_fore_color_;
         const RendererSettings& renderer_settings_;
         bool is_stop_;
@@ -115,35 +116,39 @@ namespace map_renderer{
     public:
         void ApplyRendererSettings(RendererSettings);
         RendererSettings GetRendererSettings() const;
+        // SVG text of the map rendered by make_base and stored in the base; dropped when the settings change.
+        void ApplyRenderedMap(std::string rendered_map);
+        const std::optional<std::string>& GetRenderedMap() const;
         void AddRouteLinesToRender(std::vector<std::unique_ptr<svg::Drawable>>& picture_,
             SphereProjector& sp,
-            std::map<const std::string, transport_catalogue::RendererData>& routes_to_render);
+            std::map<std::string_view, transport_catalogue::RendererData>& routes_to_render) const;
         void AddRouteLabelsToRender(std::vector<std::unique_ptr<svg::Drawable>>& picture_,
             SphereProjector& sp,
-            std::map<const std::string, transport_catalogue::RendererData>& routes_to_render);
+            std::map<std::string_view, transport_catalogue::RendererData>& routes_to_render) const;
         void AddStopLabelsToRender(std::vector<std::unique_ptr<svg::Drawable>>& picture_,
             SphereProjector& sp,
-            std::map<std::string_view, geo::Coordinates> all_unique_stops);
+            std::map<std::string_view, geo::Coordinates> all_unique_stops) const;
         void AddStopIconsToRender(std::vector<std::unique_ptr<svg::Drawable>>& picture_,
             SphereProjector& sp,
-            std::map<std::string_view, geo::Coordinates> all_unique_stops);
+            std::map<std::string_view, geo::Coordinates> all_unique_stops) const;
 
-        svg::Document RenderMap(std::map<const std::string, transport_catalogue::RendererData>&);
+        // Does not change the renderer, so maps can be rendered concurrently.
+        svg::Document RenderMap(std::map<std::string_view, transport_catalogue::RendererData>&) const;
 
         template <typename DrawableIterator>
-        void DrawPicture(DrawableIterator begin, DrawableIterator end, svg::ObjectContainer& target){
+        void DrawPicture(DrawableIterator begin, DrawableIterator end, svg::ObjectContainer& target) const{
             for (auto it = begin; it != end; ++it){
                 (*it)->Draw(target);
             }
         }
         template <typename Container>
-        void DrawPicture(const Container& container, svg::ObjectContainer& target){
+        void DrawPicture(const Container& container, svg::ObjectContainer& target) const{
             DrawPicture(begin(container), end(container), target);
         }
     private:
         RendererSettings settings_;
-        size_t pallette_item_ = 0; 
-        const svg::Color GetColorFromPallete();
-        void ResetPallette();
+        std::optional<std::string> rendered_map_;
+        // Returns the color at pallette_item and advances it, going round the palette.
+        const svg::Color GetColorFromPallete(size_t& pallette_item) const;
     };
 }
\ No newline at end of file
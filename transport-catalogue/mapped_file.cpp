@@ -0,0 +1,64 @@
+#include "mapped_file.h"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TC_HAS_MMAP
+#endif
+
+using namespace std;
+namespace io{
+	MappedFile::MappedFile(const string& path){
+#ifdef TC_HAS_MMAP
+		const int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0){
+			throw runtime_error("Can't open file " + path);
+		}
+		struct stat file_stat{};
+		if (fstat(fd, &file_stat) != 0){
+			close(fd);
+			throw runtime_error("Can't read file " + path);
+		}
+		// Pipes and other special files report no size; they are read as streams below.
+		const bool regular = S_ISREG(file_stat.st_mode);
+		size_ = regular ? static_cast<size_t>(file_stat.st_size) : 0;
+		if (size_ > 0){
+			void* address = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (address != MAP_FAILED){
+				madvise(address, size_, MADV_SEQUENTIAL);
+				data_ = static_cast<const char*>(address);
+				mapped_ = true;
+			}
+		}
+		close(fd);
+		if (mapped_ || (regular && size_ == 0)){
+			return;
+		}
+#endif
+		ifstream input(path, ios::binary);
+		if (!input){
+			throw runtime_error("Can't open file " + path);
+		}
+		buffer_.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+		data_ = buffer_.data();
+		size_ = buffer_.size();
+	}
+
+	MappedFile::~MappedFile(){
+#ifdef TC_HAS_MMAP
+		if (mapped_){
+			munmap(const_cast<char*>(data_), size_);
+		}
+#endif
+	}
+
+	string_view MappedFile::GetContents() const{
+		return string_view(data_, size_);
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace io{
+    // Read-only view of a whole file. The file is memory-mapped where the platform allows it
+    // and read into memory otherwise.
+    class MappedFile{
+    public:
+        explicit MappedFile(const std::string& path);
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        std::string_view GetContents() const;
+    private:
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+        bool mapped_ = false;
+        std::string buffer_;
+    };
+}
@@ -0,0 +1,23 @@
+#include "name_arena.h"
+
+#include <algorithm>
+using namespace std;
+namespace transport_catalogue{
+	string_view NameArena::Intern(string_view name){
+		if (const auto it = names_.find(name); it != names_.end()){
+			return *it;
+		}
+		if (name.size() > block_free_){
+			// A name longer than a block gets a block of its own.
+			const size_t block_size = max(BLOCK_SIZE, name.size());
+			blocks_.push_back(make_unique<char[]>(block_size));
+			block_end_ = blocks_.back().get();
+			block_free_ = block_size;
+		}
+		char* stored = block_end_;
+		copy(name.begin(), name.end(), stored);
+		block_end_ += name.size();
+		block_free_ -= name.size();
+		return *names_.insert(string_view(stored, name.size())).first;
+	}
+}
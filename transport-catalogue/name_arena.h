@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace transport_catalogue{
+    // Keeps one copy of every stop and bus name in large blocks instead of a string per name.
+    // The views it returns stay valid while the arena lives, so it is neither copied nor moved.
+    class NameArena{
+    public:
+        NameArena() = default;
+        NameArena(const NameArena&) = delete;
+        NameArena& operator=(const NameArena&) = delete;
+
+        // Returns the stored copy of the name, storing it first if needed.
+        std::string_view Intern(std::string_view name);
+    private:
+        static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+        std::vector<std::unique_ptr<char[]>> blocks_;
+        size_t block_free_ = 0;
+        char* block_end_ = nullptr;
+        std::unordered_set<std::string_view> names_;
+    };
+}
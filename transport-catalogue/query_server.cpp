@@ -0,0 +1,366 @@
+#include "query_server.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__linux__)
+#include <arpa/inet.h>
+#include <csignal>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define TC_HAS_EPOLL
+#endif
+
+using namespace std;
+namespace server{
+#ifdef TC_HAS_EPOLL
+	namespace{
+		// epoll data of the descriptors that are not connections.
+		constexpr uint64_t LISTEN_ID = 0;
+		constexpr uint64_t WAKE_ID = 1;
+		constexpr uint64_t SIGNAL_ID = 2;
+		constexpr uint64_t FIRST_CONNECTION_ID = 3;
+
+		constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+		// A connection stops being read while it has this many queries without written answers
+		// or this many bytes of answers not taken by the client.
+		constexpr uint64_t MAX_QUERIES_IN_FLIGHT = 256;
+		constexpr size_t MAX_OUTPUT_SIZE = 4 * 1024 * 1024;
+		// A longer line is not a query: the connection is closed.
+		constexpr size_t MAX_QUERY_SIZE = 1024 * 1024;
+		constexpr int MAX_EVENTS = 64;
+
+		runtime_error SystemError(const string& action){
+			return runtime_error(action + ": "s + strerror(errno));
+		}
+
+		sigset_t GetStopSignals(){
+			sigset_t signals;
+			sigemptyset(&signals);
+			sigaddset(&signals, SIGINT);
+			sigaddset(&signals, SIGTERM);
+			return signals;
+		}
+
+		bool IsBlank(string_view line){
+			return all_of(line.begin(), line.end(), [](unsigned char c){ return isspace(c); });
+		}
+	}
+
+	QueryServer::QueryServer(const ServerSettings& settings, QueryHandler handler)
+		: settings_(settings), handler_(move(handler)), next_connection_id_(FIRST_CONNECTION_ID)
+	{
+		try{
+			epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+			if (epoll_fd_ < 0){
+				throw SystemError("Can't create epoll");
+			}
+			wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (wake_fd_ < 0){
+				throw SystemError("Can't create eventfd");
+			}
+			const sigset_t stop_signals = GetStopSignals();
+			pthread_sigmask(SIG_BLOCK, &stop_signals, nullptr);
+			signal_fd_ = signalfd(-1, &stop_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+			if (signal_fd_ < 0){
+				throw SystemError("Can't create signalfd");
+			}
+			for (const auto& [fd, id] : { pair{ wake_fd_, WAKE_ID }, pair{ signal_fd_, SIGNAL_ID } }){
+				epoll_event event{};
+				event.events = EPOLLIN;
+				event.data.u64 = id;
+				epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+			}
+			Listen();
+			workers_ = make_unique<concurrency::ThreadPool>(settings_.threads_count);
+		}
+		catch (...){
+			for (const int fd : { listen_fd_, signal_fd_, wake_fd_, epoll_fd_ }){
+				if (fd >= 0){
+					close(fd);
+				}
+			}
+			throw;
+		}
+	}
+
+	QueryServer::~QueryServer(){
+		workers_.reset();
+		for (const auto& [id, connection] : connections_){
+			close(connection.fd);
+		}
+		close(listen_fd_);
+		if (!settings_.unix_socket.empty()){
+			unlink(settings_.unix_socket.c_str());
+		}
+		close(signal_fd_);
+		close(wake_fd_);
+		close(epoll_fd_);
+		const sigset_t stop_signals = GetStopSignals();
+		pthread_sigmask(SIG_UNBLOCK, &stop_signals, nullptr);
+	}
+
+	void QueryServer::Run(){
+		epoll_event events[MAX_EVENTS];
+		while (true){
+			const int events_count = epoll_wait(epoll_fd_, events, MAX_EVENTS, -1);
+			if (events_count < 0){
+				if (errno == EINTR){
+					continue;
+				}
+				throw SystemError("epoll_wait failed");
+			}
+			for (int i = 0; i < events_count; ++i){
+				const uint64_t id = events[i].data.u64;
+				if (id == SIGNAL_ID){
+					// Taken, so that it is not delivered once the signals are unblocked.
+					signalfd_siginfo signal_info{};
+					[[maybe_unused]] const ssize_t read_size = read(signal_fd_, &signal_info, sizeof(signal_info));
+					return;
+				}
+				if (id == LISTEN_ID){
+					AcceptConnections();
+				}
+				else if (id == WAKE_ID){
+					CollectAnswers();
+				}
+				else if (const auto it = connections_.find(id); it != connections_.end()){
+					Connection& connection = it->second;
+					if (!connection.input_closed && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))){
+						ReadConnection(id, connection);
+					}
+					if (events[i].events & EPOLLOUT){
+						WriteConnection(connection);
+					}
+					UpdateConnection(id, connection);
+				}
+			}
+		}
+	}
+
+	void QueryServer::Listen(){
+		if (!settings_.unix_socket.empty()){
+			sockaddr_un address{};
+			address.sun_family = AF_UNIX;
+			if (settings_.unix_socket.size() >= sizeof(address.sun_path)){
+				throw invalid_argument("Too long socket path " + settings_.unix_socket);
+			}
+			strcpy(address.sun_path, settings_.unix_socket.c_str());
+			// A socket left by a previous run is replaced, any other file is not.
+			struct stat file_stat{};
+			if (stat(address.sun_path, &file_stat) == 0 && S_ISSOCK(file_stat.st_mode)){
+				unlink(address.sun_path);
+			}
+			listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			if (listen_fd_ < 0 || bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0){
+				throw SystemError("Can't bind " + settings_.unix_socket);
+			}
+		}
+		else{
+			sockaddr_in address{};
+			address.sin_family = AF_INET;
+			address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			address.sin_port = htons(settings_.port);
+			listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			const int reuse = 1;
+			if (listen_fd_ < 0 || setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0
+				|| bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0){
+				throw SystemError("Can't bind port " + to_string(settings_.port));
+			}
+		}
+		if (listen(listen_fd_, SOMAXCONN) != 0){
+			throw SystemError("Can't listen");
+		}
+		epoll_event event{};
+		event.events = EPOLLIN;
+		event.data.u64 = LISTEN_ID;
+		epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event);
+	}
+
+	void QueryServer::AcceptConnections(){
+		while (true){
+			const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if (fd < 0){
+				// EAGAIN when all are accepted; on other errors the client is lost, the server goes on.
+				return;
+			}
+			if (settings_.unix_socket.empty()){
+				// Answers are small and wanted at once.
+				const int no_delay = 1;
+				setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+			}
+			const uint64_t id = next_connection_id_++;
+			Connection& connection = connections_[id];
+			connection.fd = fd;
+			connection.events = EPOLLIN;
+			epoll_event event{};
+			event.events = connection.events;
+			event.data.u64 = id;
+			epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+		}
+	}
+
+	void QueryServer::ReadConnection(uint64_t connection_id, Connection& connection){
+		// One chunk per event, so that a busy client does not hold up the others.
+		const size_t old_size = connection.input.size();
+		connection.input.resize(old_size + READ_CHUNK_SIZE);
+		const ssize_t read_size = recv(connection.fd, connection.input.data() + old_size, READ_CHUNK_SIZE, 0);
+		connection.input.resize(old_size + static_cast<size_t>(max<ssize_t>(read_size, 0)));
+		if (read_size == 0){
+			connection.input_closed = true;
+			// The last query may have no line break.
+			if (!connection.input.empty()){
+				connection.input += '\n';
+			}
+		}
+		else if (read_size < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+			connection.input_closed = true;
+			connection.input.clear();
+		}
+		SubmitQueries(connection_id, connection);
+	}
+
+	void QueryServer::SubmitQueries(uint64_t connection_id, Connection& connection){
+		size_t begin = 0;
+		while (connection.next_query - connection.next_answer < MAX_QUERIES_IN_FLIGHT){
+			const size_t end = connection.input.find('\n', begin);
+			if (end == string::npos){
+				break;
+			}
+			string query = connection.input.substr(begin, end - begin);
+			begin = end + 1;
+			if (IsBlank(query)){
+				continue;
+			}
+			workers_->Submit([this, connection_id, query_index = connection.next_query++, query = move(query)]{
+				string text;
+				handler_(query, text);
+				{
+					lock_guard lock(answers_mutex_);
+					answers_.push_back({ connection_id, query_index, move(text) });
+				}
+				const uint64_t one = 1;
+				[[maybe_unused]] const ssize_t written = write(wake_fd_, &one, sizeof(one));
+			});
+		}
+		connection.input.erase(0, begin);
+	}
+
+	void QueryServer::CollectAnswers(){
+		uint64_t wakes_count = 0;
+		[[maybe_unused]] const ssize_t read_size = read(wake_fd_, &wakes_count, sizeof(wakes_count));
+		vector<Answer> answers;
+		{
+			lock_guard lock(answers_mutex_);
+			answers.swap(answers_);
+		}
+		vector<uint64_t> updated_ids;
+		for (Answer& answer : answers){
+			const auto it = connections_.find(answer.connection_id);
+			if (it == connections_.end()){
+				continue;
+			}
+			Connection& connection = it->second;
+			connection.early_answers.emplace(answer.query, move(answer.text));
+			updated_ids.push_back(answer.connection_id);
+		}
+		sort(updated_ids.begin(), updated_ids.end());
+		updated_ids.erase(unique(updated_ids.begin(), updated_ids.end()), updated_ids.end());
+		for (const uint64_t id : updated_ids){
+			Connection& connection = connections_.at(id);
+			auto& early_answers = connection.early_answers;
+			while (!early_answers.empty() && early_answers.begin()->first == connection.next_answer){
+				connection.output += early_answers.begin()->second;
+				early_answers.erase(early_answers.begin());
+				++connection.next_answer;
+			}
+			WriteConnection(connection);
+			// Queries held back by the limit of queries in flight.
+			SubmitQueries(id, connection);
+			UpdateConnection(id, connection);
+		}
+	}
+
+	void QueryServer::WriteConnection(Connection& connection){
+		while (connection.output_sent < connection.output.size()){
+			const ssize_t sent = send(connection.fd, connection.output.data() + connection.output_sent,
+				connection.output.size() - connection.output_sent, MSG_NOSIGNAL);
+			if (sent < 0){
+				if (errno == EINTR){
+					continue;
+				}
+				if (errno != EAGAIN && errno != EWOULDBLOCK){
+					// The client is gone: nothing more is read from it or written to it.
+					connection.input_closed = true;
+					connection.input.clear();
+					connection.output.clear();
+					connection.output_sent = 0;
+				}
+				break;
+			}
+			connection.output_sent += static_cast<size_t>(sent);
+		}
+		if (connection.output_sent == connection.output.size()){
+			connection.output.clear();
+			connection.output_sent = 0;
+		}
+	}
+
+	void QueryServer::UpdateConnection(uint64_t connection_id, Connection& connection){
+		const bool queries_in_flight = connection.next_query != connection.next_answer;
+		if (connection.input.size() > MAX_QUERY_SIZE && connection.input.find('\n') == string::npos){
+			CloseConnection(connection_id);
+			return;
+		}
+		if (connection.input_closed && !queries_in_flight && connection.output.empty()){
+			CloseConnection(connection_id);
+			return;
+		}
+		uint32_t events = 0;
+		if (!connection.input_closed && connection.next_query - connection.next_answer < MAX_QUERIES_IN_FLIGHT
+			&& connection.output.size() < MAX_OUTPUT_SIZE){
+			events |= EPOLLIN;
+		}
+		if (!connection.output.empty()){
+			events |= EPOLLOUT;
+		}
+		if (events != connection.events){
+			// A connection that waits for nothing leaves epoll, as EPOLLHUP can't be masked.
+			const int operation = connection.events == 0 ? EPOLL_CTL_ADD : events == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+			epoll_event event{};
+			event.events = events;
+			event.data.u64 = connection_id;
+			epoll_ctl(epoll_fd_, operation, connection.fd, &event);
+			connection.events = events;
+		}
+	}
+
+	void QueryServer::CloseConnection(uint64_t connection_id){
+		const auto it = connections_.find(connection_id);
+		// Closing the descriptor removes it from epoll; answers still on the workers are dropped.
+		close(it->second.fd);
+		connections_.erase(it);
+	}
+#else
+	QueryServer::QueryServer(const ServerSettings& settings, QueryHandler handler)
+		: settings_(settings), handler_(move(handler)), next_connection_id_(0)
+	{
+		throw runtime_error("The query server needs Linux epoll");
+	}
+
+	QueryServer::~QueryServer() = default;
+
+	void QueryServer::Run(){}
+#endif
+}
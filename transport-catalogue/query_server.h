@@ -0,0 +1,86 @@
+#pragma once
+
+#include "thread_pool.h"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace server{
+    struct ServerSettings{
+        // Path of a Unix domain socket; when empty the server listens on the loopback TCP port.
+        std::string unix_socket;
+        std::uint16_t port = 0;
+        size_t threads_count = concurrency::ThreadPool::DefaultThreadsCount();
+    };
+
+    // Appends the answer to one query, a whole line with its '\n'. Called on the workers at once,
+    // so it must only read shared data; it should answer errors instead of throwing.
+    using QueryHandler = std::function<void(std::string_view query, std::string& answer)>;
+
+    // Serves newline-delimited queries to many clients of one socket. A single thread multiplexes
+    // the connections with epoll and the queries are answered on a fixed pool of workers. A client
+    // may send the next queries before the answers come: the answers of every connection are
+    // written in the order of its queries. Linux only; elsewhere the constructor throws.
+    class QueryServer{
+    public:
+        QueryServer(const ServerSettings& settings, QueryHandler handler);
+        QueryServer(const QueryServer&) = delete;
+        QueryServer& operator=(const QueryServer&) = delete;
+        ~QueryServer();
+
+        // Serves the clients until the process gets SIGINT or SIGTERM.
+        void Run();
+    private:
+        struct Connection{
+            int fd = -1;
+            std::string input;
+            std::string output;
+            size_t output_sent = 0;
+            // Sequence numbers of the next query read and of the next answer to write.
+            std::uint64_t next_query = 0;
+            std::uint64_t next_answer = 0;
+            // Answers that are ready before the answers to earlier queries.
+            std::map<std::uint64_t, std::string> early_answers;
+            bool input_closed = false;
+            std::uint32_t events = 0;
+        };
+
+        struct Answer{
+            std::uint64_t connection_id;
+            std::uint64_t query;
+            std::string text;
+        };
+
+        void Listen();
+        void AcceptConnections();
+        void ReadConnection(std::uint64_t connection_id, Connection& connection);
+        void SubmitQueries(std::uint64_t connection_id, Connection& connection);
+        void CollectAnswers();
+        void WriteConnection(Connection& connection);
+        // Closes the connection if it is done or broken, otherwise updates the events it waits for.
+        void UpdateConnection(std::uint64_t connection_id, Connection& connection);
+        void CloseConnection(std::uint64_t connection_id);
+
+        ServerSettings settings_;
+        QueryHandler handler_;
+        int listen_fd_ = -1;
+        int epoll_fd_ = -1;
+        // The workers wake the loop through it when they add answers.
+        int wake_fd_ = -1;
+        int signal_fd_ = -1;
+        std::uint64_t next_connection_id_;
+        std::unordered_map<std::uint64_t, Connection> connections_;
+        std::mutex answers_mutex_;
+        std::vector<Answer> answers_;
+        // Created after the signals are blocked, so that the workers inherit the mask;
+        // destroyed first, so that no worker is left using the other members.
+        std::unique_ptr<concurrency::ThreadPool> workers_;
+    };
+}
@@ -2,17 +2,33 @@
 using namespace std;
 
 namespace transport_catalogue{
-	const optional<RouteStatPtr> RequestHandler::GetRouteInfo(const string_view& bus_name) const{
+	RouteStatPtr RequestHandler::GetRouteInfo(const string_view& bus_name) const{
 		return tc_.GetRouteInfo(bus_name);
 	}
 
-	const optional<StopStatPtr> RequestHandler::GetBusesForStop(const string_view& stop_name) const{
+	StopStatPtr RequestHandler::GetBusesForStop(const string_view& stop_name) const{
 		return tc_.GetBusesForStopInfo(stop_name);
 	}
 
 	svg::Document RequestHandler::GetMapRender() const{
-		map<const string, transport_catalogue::RendererData> all_routes;
+		map<string_view, transport_catalogue::RendererData> all_routes;
 		tc_.GetAllRoutes(all_routes);
 		return mr_.RenderMap(all_routes);
 	}
+
+	string RequestHandler::GetRenderedMap() const{
+		if (const auto& rendered_map = mr_.GetRenderedMap()){
+			return *rendered_map;
+		}
+		string rendered_map;
+		GetMapRender().Render(rendered_map);
+		return rendered_map;
+	}
+
+	json::EscapedString RequestHandler::GetRenderedMapJSON() const{
+		call_once(rendered_map_flag_, [this]{
+			json::AppendEscapedString(rendered_map_json_, GetRenderedMap());
+		});
+		return { rendered_map_json_ };
+	}
 }
\ No newline at end of file
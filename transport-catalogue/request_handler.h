@@ -2,22 +2,34 @@
 
 #include "transport_catalogue.h"
 #include "map_renderer.h"
+#include "json_writer.h"
 
 #include <unordered_set>    
 #include <optional>         
 #include <string_view>      
 #include <map>             
+#include <mutex>
+#include <string>
 
 namespace transport_catalogue{
     class RequestHandler{
     public:
-        RequestHandler(const TransportCatalogue& tc, map_renderer::MapRenderer& mr) : tc_(tc), mr_(mr)
+        // Only reads the catalogue and the renderer, so it can be used from several threads.
+        RequestHandler(const TransportCatalogue& tc, const map_renderer::MapRenderer& mr) : tc_(tc), mr_(mr)
         {}
-        const std::optional<RouteStatPtr> GetRouteInfo(const std::string_view& bus_name) const;
-        const std::optional<StopStatPtr> GetBusesForStop(const std::string_view& stop_name) const;
+        // Statistics are owned by the catalogue; nullptr means the bus or the stop is unknown.
+        RouteStatPtr GetRouteInfo(const std::string_view& bus_name) const;
+        StopStatPtr GetBusesForStop(const std::string_view& stop_name) const;
         svg::Document GetMapRender() const;
+        // SVG text of the map: the one stored in the base, or rendered now.
+        std::string GetRenderedMap() const;
+        // The map as a quoted and escaped JSON string. The map depends only on the catalogue and
+        // the renderer settings, so it is rendered and escaped once, on the first call.
+        json::EscapedString GetRenderedMapJSON() const;
     private:
         const TransportCatalogue& tc_;
-        map_renderer::MapRenderer& mr_;
+        const map_renderer::MapRenderer& mr_;
+        mutable std::once_flag rendered_map_flag_;
+        mutable std::string rendered_map_json_;
     };
 }
\ No newline at end of file
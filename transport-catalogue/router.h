@@ -1,48 +1,84 @@
 #pragma once
 
+#include "floyd_warshall.h"
 #include "graph.h"
+#include "routes_storage.h"
+#include "thread_pool.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph{
     template <typename Weight>
-    class Router{
+    struct RouteInfo{
+        Weight weight;
+        std::vector<EdgeId> edges;
+    };
+
+    template <typename Weight>
+    class RouterBase{
+    public:
+        using RouteInfo = graph::RouteInfo<Weight>;
+        virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+        // Weights of the best routes from every source to every target, row by row, without the edges;
+        // nullopt where there is no route. Engines override it to answer the whole matrix at once.
+        virtual std::vector<std::optional<Weight>> GetRouteWeights(const std::vector<VertexId>& sources,
+            const std::vector<VertexId>& targets) const{
+            std::vector<std::optional<Weight>> weights;
+            weights.reserve(sources.size() * targets.size());
+            for (const VertexId from : sources){
+                for (const VertexId to : targets){
+                    const auto route = BuildRoute(from, to);
+                    weights.push_back(route ? std::optional<Weight>(route->weight) : std::nullopt);
+                }
+            }
+            return weights;
+        }
+        virtual ~RouterBase() = default;
+    };
+
+    // Storage is the layout of the all-pairs table: NestedRoutesStorage or FlatRoutesStorage.
+    template <typename Weight, typename Storage = NestedRoutesStorage<Weight>>
+    class Router final : public RouterBase<Weight>{
     private:
         using Graph = DirectedWeightedGraph<Weight>;
     public:
-        explicit Router(const Graph& graph);
-        struct RouteInfo{
-            Weight weight;
-            std::vector<EdgeId> edges;
-        };
-        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+        using RouteInfo = typename RouterBase<Weight>::RouteInfo;
+        using RouteInternalData = graph::RouteInternalData<Weight>;
+        using RoutesInternalData = Storage;
+
+        // A flat table with infinite weights is filled by the blocked Floyd-Warshall,
+        // split across thread_pool when it is given.
+        explicit Router(const Graph& graph, concurrency::ThreadPool* thread_pool = nullptr);
+        Router(const Graph& graph, RoutesInternalData&& routes_internal_data);
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        // Reads the weights straight from the table.
+        std::vector<std::optional<Weight>> GetRouteWeights(const std::vector<VertexId>& sources,
+            const std::vector<VertexId>& targets) const override;
+        const RoutesInternalData& GetRoutesInternalData() const;
     private:
-        struct RouteInternalData{
-            Weight weight;
-            std::optional<EdgeId> prev_edge;
-        };
-        using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
 
         void InitializeRoutesInternalData(const Graph& graph){
             const size_t vertex_count = graph.GetVertexCount();
             for (VertexId vertex = 0; vertex < vertex_count; ++vertex){
-                routes_internal_data_[vertex][vertex] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
+                routes_internal_data_.Set(vertex, vertex, RouteInternalData{ ZERO_WEIGHT, std::nullopt });
                 for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)){
                     const auto& edge = graph.GetEdge(edge_id);
                     if (edge.weight < ZERO_WEIGHT){
                         throw std::domain_error("Edges' weights should be non-negative");
                     }
-                    auto& route_internal_data = routes_internal_data_[vertex][edge.to];
+                    const auto route_internal_data = routes_internal_data_.Get(vertex, edge.to);
                     if (!route_internal_data || route_internal_data->weight > edge.weight){
-                        route_internal_data = RouteInternalData{ edge.weight, edge_id };
+                        routes_internal_data_.Set(vertex, edge.to, RouteInternalData{ edge.weight, edge_id });
                     }
                 }
             }
@@ -50,19 +86,19 @@ namespace graph{
 
         void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
             const RouteInternalData& route_to){
-            auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
+            const auto route_relaxing = routes_internal_data_.Get(vertex_from, vertex_to);
             const Weight candidate_weight = route_from.weight + route_to.weight;
             if (!route_relaxing || candidate_weight < route_relaxing->weight){
-                route_relaxing = { candidate_weight,
-                                  route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge };
+                routes_internal_data_.Set(vertex_from, vertex_to, { candidate_weight,
+                                  route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge });
             }
         }
 
         void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
             for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from){
-                if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]){
+                if (const auto route_from = routes_internal_data_.Get(vertex_from, vertex_through)){
                     for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to){
-                        if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]){
+                        if (const auto route_to = routes_internal_data_.Get(vertex_through, vertex_to)){
                             RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
                         }
                     }
@@ -75,23 +111,46 @@ namespace graph{
         RoutesInternalData routes_internal_data_;
     };
 
-    template <typename Weight>
-    Router<Weight>::Router(const Graph& graph)
+    template <typename Weight, typename Storage>
+    Router<Weight, Storage>::Router(const Graph& graph, [[maybe_unused]] concurrency::ThreadPool* thread_pool)
         : graph_(graph)
-        , routes_internal_data_(graph.GetVertexCount(),
-            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+        , routes_internal_data_(graph.GetVertexCount())
     {
         InitializeRoutesInternalData(graph);
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through){
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+        if constexpr (IsFlatRoutesStorage<Storage>::value
+            && std::numeric_limits<typename Storage::StoredWeightType>::has_infinity){
+            RunFloydWarshall(routes_internal_data_, thread_pool);
+        }
+        else{
+            const size_t vertex_count = graph.GetVertexCount();
+            for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through){
+                RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+            }
         }
     }
 
-    template <typename Weight>
-    std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
+    template <typename Weight, typename Storage>
+    Router<Weight, Storage>::Router(const Graph& graph, RoutesInternalData&& routes_internal_data)
+        : graph_(graph)
+        , routes_internal_data_(std::move(routes_internal_data))
+    {
+        if (routes_internal_data_.GetVertexCount() != graph.GetVertexCount()){
+            throw std::invalid_argument("Routes internal data does not match the graph");
+        }
+    }
+
+    template <typename Weight, typename Storage>
+    const typename Router<Weight, Storage>::RoutesInternalData& Router<Weight, Storage>::GetRoutesInternalData() const{
+        return routes_internal_data_;
+    }
+
+    template <typename Weight, typename Storage>
+    std::optional<typename Router<Weight, Storage>::RouteInfo> Router<Weight, Storage>::BuildRoute(VertexId from,
         VertexId to) const{
-        const auto& route_internal_data = routes_internal_data_.at(from).at(to);
+        if (from >= routes_internal_data_.GetVertexCount() || to >= routes_internal_data_.GetVertexCount()){
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const auto route_internal_data = routes_internal_data_.Get(from, to);
         if (!route_internal_data){
             return std::nullopt;
         }
@@ -99,11 +158,28 @@ namespace graph{
         std::vector<EdgeId> edges;
         for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
             edge_id;
-            edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge){
+            edge_id = routes_internal_data_.Get(from, graph_.GetEdge(*edge_id).from)->prev_edge){
             edges.push_back(*edge_id);
         }
         std::reverse(edges.begin(), edges.end());
         return RouteInfo{ weight, std::move(edges) };
     }
 
-}
\ No newline at end of file
+    template <typename Weight, typename Storage>
+    std::vector<std::optional<Weight>> Router<Weight, Storage>::GetRouteWeights(const std::vector<VertexId>& sources,
+        const std::vector<VertexId>& targets) const{
+        std::vector<std::optional<Weight>> weights;
+        weights.reserve(sources.size() * targets.size());
+        for (const VertexId from : sources){
+            for (const VertexId to : targets){
+                if (from >= routes_internal_data_.GetVertexCount() || to >= routes_internal_data_.GetVertexCount()){
+                    throw std::out_of_range("Vertex id is out of range");
+                }
+                const auto route_internal_data = routes_internal_data_.Get(from, to);
+                weights.push_back(route_internal_data ? std::optional<Weight>(route_internal_data->weight) : std::nullopt);
+            }
+        }
+        return weights;
+    }
+
+}
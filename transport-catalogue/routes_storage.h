@@ -0,0 +1,123 @@
+#pragma once
+
+#include "graph.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graph{
+    template <typename Weight>
+    struct RouteInternalData{
+        Weight weight;
+        std::optional<EdgeId> prev_edge;
+    };
+
+    // Table of graph::Router as a vector of rows of optional cells.
+    template <typename Weight>
+    class NestedRoutesStorage{
+    public:
+        using RouteInternalData = graph::RouteInternalData<Weight>;
+
+        NestedRoutesStorage() = default;
+        explicit NestedRoutesStorage(size_t vertex_count)
+            : data_(vertex_count, std::vector<std::optional<RouteInternalData>>(vertex_count))
+        {}
+
+        size_t GetVertexCount() const{
+            return data_.size();
+        }
+        std::optional<RouteInternalData> Get(VertexId from, VertexId to) const{
+            return data_[from][to];
+        }
+        void Set(VertexId from, VertexId to, const RouteInternalData& route_internal_data){
+            data_[from][to] = route_internal_data;
+        }
+    private:
+        std::vector<std::vector<std::optional<RouteInternalData>>> data_;
+    };
+
+    // Table of graph::Router as two contiguous row-major arrays: weights and previous edge ids.
+    // A missing route and a route without previous edge are marked by sentinel edge ids
+    // instead of std::optional, so a cell takes sizeof(StoredWeight) + sizeof(EdgeIndex) bytes.
+    template <typename Weight, typename StoredWeight = Weight, typename EdgeIndex = std::uint32_t>
+    class FlatRoutesStorage{
+    public:
+        using RouteInternalData = graph::RouteInternalData<Weight>;
+        using StoredWeightType = StoredWeight;
+        using EdgeIndexType = EdgeIndex;
+        static constexpr EdgeIndex NO_ROUTE = std::numeric_limits<EdgeIndex>::max();
+        static constexpr EdgeIndex NO_PREV_EDGE = NO_ROUTE - 1;
+        static constexpr StoredWeight NO_WEIGHT = std::numeric_limits<StoredWeight>::has_infinity
+            ? std::numeric_limits<StoredWeight>::infinity() : std::numeric_limits<StoredWeight>::max();
+
+        FlatRoutesStorage() = default;
+        explicit FlatRoutesStorage(size_t vertex_count)
+            : vertex_count_(vertex_count)
+            , weights_(vertex_count * vertex_count, NO_WEIGHT)
+            , prev_edges_(vertex_count * vertex_count, NO_ROUTE)
+        {}
+        // Read-only table over arrays of vertex_count * vertex_count cells kept alive by owner,
+        // e.g. a mapped base file. Set and the row accessors must not be used with it.
+        FlatRoutesStorage(size_t vertex_count, const StoredWeight* weights, const EdgeIndex* prev_edges,
+            std::shared_ptr<const void> owner)
+            : vertex_count_(vertex_count)
+            , external_weights_(weights)
+            , external_prev_edges_(prev_edges)
+            , owner_(std::move(owner))
+        {}
+
+        size_t GetVertexCount() const{
+            return vertex_count_;
+        }
+        std::optional<RouteInternalData> Get(VertexId from, VertexId to) const{
+            const size_t cell = from * vertex_count_ + to;
+            const EdgeIndex prev_edge = GetPrevEdges()[cell];
+            if (prev_edge == NO_ROUTE){
+                return std::nullopt;
+            }
+            return RouteInternalData{ static_cast<Weight>(GetWeights()[cell]),
+                prev_edge == NO_PREV_EDGE ? std::nullopt : std::optional<EdgeId>(prev_edge) };
+        }
+        void Set(VertexId from, VertexId to, const RouteInternalData& route_internal_data){
+            const size_t cell = from * vertex_count_ + to;
+            if (route_internal_data.prev_edge && *route_internal_data.prev_edge >= NO_PREV_EDGE){
+                throw std::overflow_error("Edge id does not fit the routes storage");
+            }
+            weights_[cell] = static_cast<StoredWeight>(route_internal_data.weight);
+            prev_edges_[cell] = route_internal_data.prev_edge ? static_cast<EdgeIndex>(*route_internal_data.prev_edge) : NO_PREV_EDGE;
+        }
+
+        StoredWeight* GetWeightsRow(VertexId from){
+            return weights_.data() + from * vertex_count_;
+        }
+        EdgeIndex* GetPrevEdgesRow(VertexId from){
+            return prev_edges_.data() + from * vertex_count_;
+        }
+        // The whole row-major tables.
+        const StoredWeight* GetWeights() const{
+            return external_weights_ != nullptr ? external_weights_ : weights_.data();
+        }
+        const EdgeIndex* GetPrevEdges() const{
+            return external_prev_edges_ != nullptr ? external_prev_edges_ : prev_edges_.data();
+        }
+    private:
+        size_t vertex_count_ = 0;
+        std::vector<StoredWeight> weights_;
+        std::vector<EdgeIndex> prev_edges_;
+        const StoredWeight* external_weights_ = nullptr;
+        const EdgeIndex* external_prev_edges_ = nullptr;
+        std::shared_ptr<const void> owner_;
+    };
+
+    template <typename Storage>
+    struct IsFlatRoutesStorage : std::false_type{};
+
+    template <typename Weight, typename StoredWeight, typename EdgeIndex>
+    struct IsFlatRoutesStorage<FlatRoutesStorage<Weight, StoredWeight, EdgeIndex>> : std::true_type{};
+}
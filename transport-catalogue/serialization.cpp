@@ -1,26 +1,74 @@
 #include "serialization.h"
+
+#include <cmath>
+#include <limits>
 using namespace std;
 namespace serialization{
+	namespace{
+		constexpr uint32_t BASE_VERSION = 2;
+		// Fixed-point coordinates of version 2 are in 1e-7 of a degree, about a centimeter.
+		constexpr double COORDINATE_SCALE = 1e7;
+
+		int64_t ToFixedPoint(double coordinate){
+			return llround(coordinate * COORDINATE_SCALE);
+		}
+
+		double FromFixedPoint(int64_t coordinate){
+			return static_cast<double>(coordinate) / COORDINATE_SCALE;
+		}
+
+		// Coordinates read from JSON with up to 7 decimal places come back bit-exact.
+		bool IsFixedPointExact(double coordinate){
+			return abs(coordinate) <= 360.0 && FromFixedPoint(ToFixedPoint(coordinate)) == coordinate;
+		}
+	}
+
 	Serializer::Serializer(transport_catalogue::TransportCatalogue& tc,
 		map_renderer::MapRenderer& mr,
 		router::TransportRouter* tr): tc_(tc), mr_(mr), tr_(tr){}
 
-	void Serializer::Serialize(const string& filename){
+	void Serializer::Serialize(const string& filename, BaseFormat format){
 		ofstream out(filename, ios::binary);
+		if (format == BaseFormat::FLAT){
+			SerializeFlat(out);
+			return;
+		}
 		proto_all_settings_.Clear();
+		proto_all_settings_.set_version(BASE_VERSION);
+		IndexCatalogue();
 		SerializeStop();
 		SerializeDistance();
 		SerializeRoute();
 		SerializeRendererSettings();
+		SerializeRenderedMap();
 		SerializeRouterSettings();
-		proto_all_settings_.SerializeToOstream(&out);
+		SerializeRouter();
+		if (proto_all_settings_.ByteSizeLong() > static_cast<size_t>(numeric_limits<int>::max())){
+			throw runtime_error("The base is 2 GiB or more, use \"format\": \"flat\" in serialization_settings");
+		}
+		if (!proto_all_settings_.SerializeToOstream(&out)){
+			throw runtime_error("Can't write the base " + filename);
+		}
 	}
 
 	void Serializer::Deserialize(const string& filename){
-		std::ifstream in(filename, ios::binary);
+		auto file = make_shared<const io::MappedFile>(filename);
 		proto_all_settings_.Clear();
-		proto_all_settings_.ParseFromIstream(&in);
-		DeserializeCatalogue();
+		if (flat_base::IsFlatBase(file->GetContents())){
+			flat_base_.emplace(move(file));
+			DeserializeFlatCatalogue();
+		}
+		else{
+			const string_view contents = file->GetContents();
+			// Protobuf takes the length as an int and can't parse messages of 2 GiB or more.
+			if (contents.size() > static_cast<size_t>(numeric_limits<int>::max())){
+				throw runtime_error("Protobuf base is 2 GiB or more, such bases need \"format\": \"flat\"");
+			}
+			if (!proto_all_settings_.ParseFromArray(contents.data(), static_cast<int>(contents.size()))){
+				throw runtime_error("Corrupted base " + filename);
+			}
+			DeserializeCatalogue();
+		}
 		DeserializeRenderer();
 	}
 
@@ -34,35 +82,67 @@ namespace serialization{
 		router::RouterSettings r_settings;
 		r_settings.bus_velocity = proto_rt_settings.bus_velocity();
 		r_settings.bus_wait_time = proto_rt_settings.bus_wait_time();
+		r_settings.router_engine = DeserializeRouterEngine(proto_rt_settings.router_engine());
 		tr_->ApplyRouterSettings(r_settings);
+		if (flat_base_){
+			DeserializeFlatRouterData();
+		}
+		else if (proto_all_settings_.has_router()){
+			DeserializeRouterData();
+		}
+	}
+
+	void Serializer::IndexCatalogue(){
+		stops_by_index_ = tc_.GetAllStopsPtr();
+		stop_indexes_.clear();
+		for (uint32_t stop_index = 0; stop_index < stops_by_index_.size(); ++stop_index){
+			stop_indexes_.insert({ stops_by_index_[stop_index], stop_index });
+		}
+		const deque<const transport_catalogue::Route*> routes = tc_.GetAllRoutesPtr();
+		routes_by_index_.assign(routes.begin(), routes.end());
+		route_indexes_.clear();
+		for (uint32_t route_index = 0; route_index < routes_by_index_.size(); ++route_index){
+			route_indexes_.insert({ routes_by_index_[route_index]->route_name, route_index });
+		}
 	}
 
 	void Serializer::SerializeStop(){
-		for (const auto& stop : tc_.GetAllStopsPtr()){
-			proto_serialization::Stop proto_stop;
-			proto_serialization::Coordinates proto_coords;
-			proto_coords.set_lat(stop->coords.lat);
-			proto_coords.set_lng(stop->coords.lng);
-			*proto_stop.mutable_coords() = proto_coords;
-			proto_stop.set_name(stop->name);
-			*proto_all_settings_.add_stops() = proto_stop;
+		proto_serialization::StopList* proto_stops = proto_all_settings_.mutable_stop_list();
+		const bool fixed_point = all_of(stops_by_index_.begin(), stops_by_index_.end(), [](const transport_catalogue::Stop* stop){
+			return IsFixedPointExact(stop->coords.lat) && IsFixedPointExact(stop->coords.lng);
+		});
+		int64_t prev_lat = 0;
+		int64_t prev_lng = 0;
+		for (const auto& stop : stops_by_index_){
+			proto_stops->add_name(stop->name.data(), stop->name.size());
+			if (fixed_point){
+				const int64_t lat = ToFixedPoint(stop->coords.lat);
+				const int64_t lng = ToFixedPoint(stop->coords.lng);
+				proto_stops->add_lat_delta(lat - prev_lat);
+				proto_stops->add_lng_delta(lng - prev_lng);
+				prev_lat = lat;
+				prev_lng = lng;
+			}
+			else{
+				proto_stops->add_lat(stop->coords.lat);
+				proto_stops->add_lng(stop->coords.lng);
+			}
 		}
 	}
 
 	void Serializer::SerializeDistance(){
+		proto_serialization::DistanceList* proto_distances = proto_all_settings_.mutable_distance_list();
 		for (const auto& distance : tc_.GetAllDistances()){
-			proto_serialization::Distance proto_distance;
-			proto_distance.set_from(distance.first.first->name);
-			proto_distance.set_to(distance.first.second->name);
-			proto_distance.set_distance(distance.second);
-			*proto_all_settings_.add_distances() = proto_distance;
+			proto_distances->add_from(stop_indexes_.at(distance.from));
+			proto_distances->add_to(stop_indexes_.at(distance.to));
+			proto_distances->add_distance(distance.meters);
 		}
 	}
 
 	void Serializer::SerializeRoute(){
-		for (const auto& route : tc_.GetAllRoutesPtr()){
+		for (const auto& route : routes_by_index_){
 			proto_serialization::Route proto_route;
-			proto_route.set_route_name(route->route_name);
+			proto_route.set_route_name(route->route_name.data(), route->route_name.size());
 			proto_route.set_is_circular(route->is_circular);
 
 			size_t num_stops_to_process = (route->is_circular ? route->stops.size() : route->stops.size() / 2 + 1);
@@ -71,13 +151,17 @@ namespace serialization{
 					break;
 				}
 				--num_stops_to_process;
-				proto_serialization::Stop proto_stop;
-				proto_serialization::Coordinates proto_coords;
-				proto_coords.set_lat(stop->coords.lat);
-				proto_coords.set_lng(stop->coords.lng);
-				proto_stop.set_name(stop->name);
-				*proto_stop.mutable_coords() = proto_coords;
-				*proto_route.add_stops() = proto_stop;
+				proto_route.add_stop_indexes(stop_indexes_.at(stop));
+			}
+			for (const double departure : route->departures){
+				proto_route.add_departures(departure);
+			}
+			if (const transport_catalogue::RouteStatPtr route_stat = tc_.GetRouteInfo(route->route_name)){
+				proto_serialization::RouteStat* proto_stat = proto_route.mutable_stat();
+				proto_stat->set_stop_count(route_stat->stops_on_route);
+				proto_stat->set_unique_stop_count(route_stat->unique_stops);
+				proto_stat->set_route_length(route_stat->meters_route_length);
+				proto_stat->set_curvature(route_stat->curvature);
 			}
 
 			*proto_all_settings_.add_routes() = proto_route;
@@ -142,6 +226,11 @@ namespace serialization{
 		*proto_all_settings_.mutable_renderer_settings() = proto_renderer_settings;
 	}
 
+	void Serializer::SerializeRenderedMap(){
+		if (const auto& rendered_map = mr_.GetRenderedMap()){
+			proto_all_settings_.set_rendered_map(*rendered_map);
+		}
+	}
 
 	void Serializer::SerializeRouterSettings(){
 		proto_serialization::RouterSettings proto_router_settings;
@@ -149,11 +238,250 @@ namespace serialization{
 
 		proto_router_settings.set_bus_velocity(rt_settings.bus_velocity);
 		proto_router_settings.set_bus_wait_time(rt_settings.bus_wait_time);
+		proto_router_settings.set_router_engine(SerializeRouterEngine(rt_settings.router_engine));
 
 		*proto_all_settings_.mutable_router_settings() = proto_router_settings;
 	}
 
+	void Serializer::SerializeRouter(){
+		if (tr_ == nullptr || !tr_->IsGraphBuilt()){
+			return;
+		}
+		proto_serialization::TransportRouter proto_router;
+		*proto_router.mutable_graph() = SerializeGraph(tr_->GetGraph());
+		const auto& vertexes_travel = tr_->GetTravelVertexes();
+		for (const auto& [stop_name, wait_id] : tr_->GetWaitVertexes()){
+			proto_serialization::Vertexes proto_vertexes;
+			proto_vertexes.set_stop_index(stop_indexes_.at(tc_.GetStopByName(stop_name)));
+			proto_vertexes.set_wait(wait_id);
+			proto_vertexes.set_travel(vertexes_travel.at(stop_name));
+			*proto_router.add_vertexes() = proto_vertexes;
+		}
+		if (tr_->IsBuilt()){
+			if (const auto* fw_router = dynamic_cast<const router::FloydWarshallRouter*>(&tr_->GetRouter())){
+				*proto_router.mutable_router() = SerializeRoutesInternalData(fw_router->GetRoutesInternalData());
+			}
+			else if (const auto* ch_router = dynamic_cast<const graph::ContractionHierarchyRouter<double>*>(&tr_->GetRouter())){
+				*proto_router.mutable_contraction_hierarchy() = SerializeContractionHierarchy(ch_router->GetHierarchy());
+			}
+		}
+		*proto_all_settings_.mutable_router() = proto_router;
+	}
+
+	proto_serialization::RouterEngine Serializer::SerializeRouterEngine(router::RouterEngine router_engine){
+		switch (router_engine){
+		case router::RouterEngine::DIJKSTRA:
+			return proto_serialization::DIJKSTRA;
+		case router::RouterEngine::CONTRACTION_HIERARCHIES:
+			return proto_serialization::CONTRACTION_HIERARCHIES;
+		case router::RouterEngine::FLOYD_WARSHALL:
+			break;
+		}
+		return proto_serialization::FLOYD_WARSHALL;
+	}
+
+	router::RouterEngine Serializer::DeserializeRouterEngine(proto_serialization::RouterEngine proto_router_engine){
+		switch (proto_router_engine){
+		case proto_serialization::DIJKSTRA:
+			return router::RouterEngine::DIJKSTRA;
+		case proto_serialization::CONTRACTION_HIERARCHIES:
+			return router::RouterEngine::CONTRACTION_HIERARCHIES;
+		default:
+			break;
+		}
+		return router::RouterEngine::FLOYD_WARSHALL;
+	}
+
+	proto_serialization::Graph Serializer::SerializeGraph(const graph::DirectedWeightedGraph<double>& dw_graph){
+		proto_serialization::Graph proto_graph;
+		proto_graph.set_vertex_count(dw_graph.GetVertexCount());
+		proto_serialization::EdgeList* proto_edges = proto_graph.mutable_edge_list();
+		for (graph::EdgeId edge_id = 0; edge_id < dw_graph.GetEdgeCount(); ++edge_id){
+			const auto& edge = dw_graph.GetEdge(edge_id);
+			proto_edges->add_from(edge.from);
+			proto_edges->add_to(edge.to);
+			proto_edges->add_weight(edge.weight);
+			if (edge.type == graph::EdgeType::WAIT){
+				proto_edges->add_name_index(stop_indexes_.at(tc_.GetStopByName(edge.edge_name)));
+				proto_edges->add_type(proto_serialization::WAIT);
+			}
+			else{
+				proto_edges->add_name_index(route_indexes_.at(edge.edge_name));
+				proto_edges->add_type(proto_serialization::TRAVEL);
+			}
+			proto_edges->add_span_count(edge.span_count);
+		}
+		return proto_graph;
+	}
+
+	proto_serialization::Router Serializer::SerializeRoutesInternalData(const router::RoutesStorage& routes_internal_data){
+		proto_serialization::Router proto_router;
+		const size_t vertex_count = routes_internal_data.GetVertexCount();
+		// Every cell takes at least a packed double and a one-byte varint, and a protobuf message
+		// can't reach 2 GiB. The flat base keeps the table in a section of its own.
+		if (vertex_count * vertex_count > static_cast<size_t>(numeric_limits<int>::max()) / (sizeof(double) + 1)){
+			throw runtime_error("The Floyd-Warshall table of " + to_string(vertex_count)
+				+ " vertexes does not fit a protobuf base, use \"format\": \"flat\" in serialization_settings");
+		}
+		for (size_t vertex_from = 0; vertex_from < vertex_count; ++vertex_from){
+			for (size_t vertex_to = 0; vertex_to < vertex_count; ++vertex_to){
+				const auto route_internal_data = routes_internal_data.Get(vertex_from, vertex_to);
+				if (!route_internal_data){
+					proto_router.add_weight(0);
+					proto_router.add_prev_edge(0);
+				}
+				else{
+					proto_router.add_weight(route_internal_data->weight);
+					proto_router.add_prev_edge(route_internal_data->prev_edge ? *route_internal_data->prev_edge + 2 : 1);
+				}
+			}
+		}
+		return proto_router;
+	}
+
+	proto_serialization::ContractionHierarchy Serializer::SerializeContractionHierarchy(
+		const graph::ContractionHierarchyRouter<double>::Hierarchy& hierarchy){
+		proto_serialization::ContractionHierarchy proto_hierarchy;
+		for (const size_t rank : hierarchy.ranks){
+			proto_hierarchy.add_rank(rank);
+		}
+		for (const auto& shortcut : hierarchy.shortcuts){
+			proto_hierarchy.add_shortcut_from(shortcut.from);
+			proto_hierarchy.add_shortcut_to(shortcut.to);
+			proto_hierarchy.add_shortcut_weight(shortcut.weight);
+			proto_hierarchy.add_shortcut_first(shortcut.first_edge);
+			proto_hierarchy.add_shortcut_second(shortcut.second_edge);
+		}
+		return proto_hierarchy;
+	}
+
+	graph::ContractionHierarchyRouter<double>::Hierarchy Serializer::DeserializeContractionHierarchy(
+		const proto_serialization::ContractionHierarchy& proto_hierarchy){
+		const int shortcuts_count = proto_hierarchy.shortcut_from_size();
+		if (proto_hierarchy.shortcut_to_size() != shortcuts_count || proto_hierarchy.shortcut_weight_size() != shortcuts_count
+			|| proto_hierarchy.shortcut_first_size() != shortcuts_count || proto_hierarchy.shortcut_second_size() != shortcuts_count){
+			throw runtime_error("Corrupted contraction hierarchy data");
+		}
+		graph::ContractionHierarchyRouter<double>::Hierarchy hierarchy;
+		hierarchy.ranks.assign(proto_hierarchy.rank().begin(), proto_hierarchy.rank().end());
+		hierarchy.shortcuts.reserve(shortcuts_count);
+		for (int i = 0; i < shortcuts_count; ++i){
+			hierarchy.shortcuts.push_back({
+				proto_hierarchy.shortcut_from(i),
+				proto_hierarchy.shortcut_to(i),
+				proto_hierarchy.shortcut_weight(i),
+				proto_hierarchy.shortcut_first(i),
+				proto_hierarchy.shortcut_second(i) });
+		}
+		return hierarchy;
+	}
+
+	void Serializer::DeserializeRouterData(){
+		const proto_serialization::TransportRouter& proto_router = proto_all_settings_.router();
+		router::VertexesMap vertexes_wait;
+		router::VertexesMap vertexes_travel;
+		for (const auto& proto_vertexes : proto_router.vertexes()){
+			const transport_catalogue::Stop* stop_ptr = proto_all_settings_.version() >= 2
+				? GetStopByIndex(proto_vertexes.stop_index()) : tc_.GetStopByName(proto_vertexes.stop_name());
+			if (stop_ptr == nullptr){
+				throw runtime_error("Router references unknown stop " + proto_vertexes.stop_name());
+			}
+			vertexes_wait.insert({ stop_ptr->name, proto_vertexes.wait() });
+			vertexes_travel.insert({ stop_ptr->name, proto_vertexes.travel() });
+		}
+		graph::DirectedWeightedGraph<double> dw_graph = DeserializeGraph(proto_router.graph());
+		const size_t vertex_count = dw_graph.GetVertexCount();
+		tr_->ApplyGraph(std::move(dw_graph), std::move(vertexes_wait), std::move(vertexes_travel));
+		const router::RouterEngine router_engine = tr_->GetRouterSettings().router_engine;
+		if (router_engine == router::RouterEngine::FLOYD_WARSHALL && proto_router.has_router()){
+			tr_->ApplyRoutesInternalData(DeserializeRoutesInternalData(proto_router.router(), vertex_count));
+		}
+		else if (router_engine == router::RouterEngine::CONTRACTION_HIERARCHIES && proto_router.has_contraction_hierarchy()){
+			tr_->ApplyContractionHierarchy(DeserializeContractionHierarchy(proto_router.contraction_hierarchy()));
+		}
+		else{
+			tr_->BuildRouter();
+		}
+	}
+
+	graph::DirectedWeightedGraph<double> Serializer::DeserializeGraph(const proto_serialization::Graph& proto_graph){
+		graph::DirectedWeightedGraph<double> dw_graph(proto_graph.vertex_count());
+		const proto_serialization::EdgeList& proto_edges = proto_graph.edge_list();
+		const int edges_count = proto_edges.from_size();
+		if (proto_edges.to_size() != edges_count || proto_edges.weight_size() != edges_count
+			|| proto_edges.name_index_size() != edges_count || proto_edges.type_size() != edges_count
+			|| proto_edges.span_count_size() != edges_count){
+			throw runtime_error("Corrupted graph data");
+		}
+		for (int i = 0; i < edges_count; ++i){
+			const bool is_wait = proto_edges.type(i) == proto_serialization::WAIT;
+			dw_graph.AddEdge({
+				proto_edges.from(i),
+				proto_edges.to(i),
+				proto_edges.weight(i),
+				is_wait ? GetStopByIndex(proto_edges.name_index(i))->name
+					: GetRouteByIndex(proto_edges.name_index(i))->route_name,
+				is_wait ? graph::EdgeType::WAIT : graph::EdgeType::TRAVEL,
+				proto_edges.span_count(i)
+				});
+		}
+		for (const auto& proto_edge : proto_graph.edges()){
+			dw_graph.AddEdge({
+				proto_edge.from(),
+				proto_edge.to(),
+				proto_edge.weight(),
+				DeserializeEdgeName(proto_edge),
+				proto_edge.type() == proto_serialization::WAIT ? graph::EdgeType::WAIT : graph::EdgeType::TRAVEL,
+				proto_edge.span_count()
+				});
+		}
+		return dw_graph;
+	}
+
+	string_view Serializer::DeserializeEdgeName(const proto_serialization::Edge& proto_edge) const{
+		if (proto_edge.type() == proto_serialization::WAIT){
+			if (const transport_catalogue::Stop* stop_ptr = tc_.GetStopByName(proto_edge.edge_name())){
+				return stop_ptr->name;
+			}
+		}
+		else if (const transport_catalogue::Route* route_ptr = tc_.GetRouteByName(proto_edge.edge_name())){
+			return route_ptr->route_name;
+		}
+		throw runtime_error("Router references unknown name " + proto_edge.edge_name());
+	}
+
+	router::RoutesStorage Serializer::DeserializeRoutesInternalData(const proto_serialization::Router& proto_router,
+		size_t vertex_count){
+		if (static_cast<size_t>(proto_router.weight_size()) != vertex_count * vertex_count
+			|| proto_router.prev_edge_size() != proto_router.weight_size()){
+			throw runtime_error("Corrupted router data");
+		}
+		router::RoutesStorage routes_internal_data(vertex_count);
+		const double* weights = proto_router.weight().data();
+		const uint64_t* prev_edges = proto_router.prev_edge().data();
+		size_t cell = 0;
+		for (size_t vertex_from = 0; vertex_from < vertex_count; ++vertex_from){
+			for (size_t vertex_to = 0; vertex_to < vertex_count; ++vertex_to, ++cell){
+				const uint64_t prev_edge = prev_edges[cell];
+				if (prev_edge == 0){
+					continue;
+				}
+				routes_internal_data.Set(vertex_from, vertex_to, graph::RouteInternalData<double>{
+					weights[cell],
+					prev_edge == 1 ? nullopt : optional<graph::EdgeId>(prev_edge - 2) });
+			}
+		}
+		return routes_internal_data;
+	}
+
 	void Serializer::DeserializeCatalogue(){
+		if (proto_all_settings_.version() > BASE_VERSION){
+			throw runtime_error("Unsupported base version " + to_string(proto_all_settings_.version()));
+		}
+		if (proto_all_settings_.version() == BASE_VERSION){
+			DeserializeCatalogueV2();
+			return;
+		}
 		for (int i = 0; i < proto_all_settings_.stops_size(); ++i){
 			proto_serialization::Stop proto_stop = proto_all_settings_.stops(i);
 			tc_.AddStop(transport_catalogue::Stop(proto_stop.name(), proto_stop.coords().lat(), proto_stop.coords().lng()));
@@ -175,11 +503,75 @@ namespace serialization{
 				route.stops.push_back(tc_.GetStopByName(proto_stop.name()));
 			}
 			tc_.AddRoute(std::move(route));
+			if (proto_route.has_stat()){
+				const proto_serialization::RouteStat& proto_stat = proto_route.stat();
+				tc_.AddRouteStat(transport_catalogue::RouteStat(proto_stat.stop_count(), proto_stat.unique_stop_count(),
+					proto_stat.route_length(), proto_stat.curvature(), proto_route.route_name()));
+			}
 		}
+		tc_.Finalize();
+	}
+
+	void Serializer::DeserializeCatalogueV2(){
+		const proto_serialization::StopList& proto_stops = proto_all_settings_.stop_list();
+		const int stops_count = proto_stops.name_size();
+		const bool fixed_point = proto_stops.lat_delta_size() == stops_count && proto_stops.lng_delta_size() == stops_count;
+		if (!fixed_point && (proto_stops.lat_size() != stops_count || proto_stops.lng_size() != stops_count)){
+			throw runtime_error("Corrupted stops data");
+		}
+		stops_by_index_.clear();
+		routes_by_index_.clear();
+		stops_by_index_.reserve(stops_count);
+		int64_t lat = 0;
+		int64_t lng = 0;
+		for (int i = 0; i < stops_count; ++i){
+			const string& name = proto_stops.name(i);
+			if (fixed_point){
+				lat += proto_stops.lat_delta(i);
+				lng += proto_stops.lng_delta(i);
+				tc_.AddStop(transport_catalogue::Stop(name, FromFixedPoint(lat), FromFixedPoint(lng)));
+			}
+			else{
+				tc_.AddStop(transport_catalogue::Stop(name, proto_stops.lat(i), proto_stops.lng(i)));
+			}
+			stops_by_index_.push_back(tc_.GetStopByName(name));
+		}
+
+		const proto_serialization::DistanceList& proto_distances = proto_all_settings_.distance_list();
+		const int distances_count = proto_distances.distance_size();
+		if (proto_distances.from_size() != distances_count || proto_distances.to_size() != distances_count){
+			throw runtime_error("Corrupted distances data");
+		}
+		for (int i = 0; i < distances_count; ++i){
+			tc_.AddDistance(GetStopByIndex(proto_distances.from(i)), GetStopByIndex(proto_distances.to(i)), proto_distances.distance(i));
+		}
+
+		routes_by_index_.reserve(proto_all_settings_.routes_size());
+		for (const auto& proto_route : proto_all_settings_.routes()){
+			transport_catalogue::Route route;
+			route.route_name = proto_route.route_name();
+			route.is_circular = proto_route.is_circular();
+			route.stops.reserve(route.is_circular ? proto_route.stop_indexes_size() : 2 * proto_route.stop_indexes_size());
+			for (const uint32_t stop_index : proto_route.stop_indexes()){
+				route.stops.push_back(GetStopByIndex(stop_index));
+			}
+			route.departures.assign(proto_route.departures().begin(), proto_route.departures().end());
+			tc_.AddRoute(std::move(route));
+			routes_by_index_.push_back(tc_.GetRouteByName(proto_route.route_name()));
+			if (proto_route.has_stat()){
+				const proto_serialization::RouteStat& proto_stat = proto_route.stat();
+				tc_.AddRouteStat(transport_catalogue::RouteStat(proto_stat.stop_count(), proto_stat.unique_stop_count(),
+					proto_stat.route_length(), proto_stat.curvature(), proto_route.route_name()));
+			}
+		}
+		tc_.Finalize();
 	}
 
 	void Serializer::DeserializeRenderer(){
      mr_.ApplyRendererSettings(DeserializeRendererSettings(proto_all_settings_.renderer_settings()));
+		if (!proto_all_settings_.rendered_map().empty()){
+			mr_.ApplyRenderedMap(proto_all_settings_.rendered_map());
+		}
 	}
 
 	map_renderer::RendererSettings Serializer::DeserializeRendererSettings(const proto_serialization::RendererSettings& proto_renderer_settings){
@@ -214,4 +606,244 @@ namespace serialization{
 		}
 		return svg::Rgb(proto_color.rgb().red(), proto_color.rgb().green(), proto_color.rgb().blue());
 	}
+
+	void Serializer::SerializeFlat(ostream& out){
+		flat_base::Writer writer;
+		IndexCatalogue();
+		vector<flat_base::StopRecord> stop_records;
+		for (const auto& stop : stops_by_index_){
+			stop_records.push_back({ writer.AddString(stop->name), stop->coords.lat, stop->coords.lng });
+		}
+
+		vector<flat_base::RouteRecord> route_records;
+		vector<uint32_t> route_stops;
+		vector<double> route_departures;
+		for (const auto& route : routes_by_index_){
+			flat_base::RouteRecord record;
+			record.name = writer.AddString(route->route_name);
+			record.is_circular = route->is_circular;
+			record.stops_begin = static_cast<uint32_t>(route_stops.size());
+			// The catalogue adds the way back of a non-circular route itself.
+			const size_t stops_count = route->is_circular ? route->stops.size() : route->stops.size() / 2 + 1;
+			for (size_t i = 0; i < stops_count && i < route->stops.size(); ++i){
+				route_stops.push_back(stop_indexes_.at(route->stops[i]));
+			}
+			record.stops_count = static_cast<uint32_t>(route_stops.size()) - record.stops_begin;
+			record.departures_begin = static_cast<uint32_t>(route_departures.size());
+			record.departures_count = static_cast<uint32_t>(route->departures.size());
+			route_departures.insert(route_departures.end(), route->departures.begin(), route->departures.end());
+			if (const transport_catalogue::RouteStatPtr route_stat = tc_.GetRouteInfo(route->route_name)){
+				record.stop_count = static_cast<uint32_t>(route_stat->stops_on_route);
+				record.unique_stop_count = static_cast<uint32_t>(route_stat->unique_stops);
+				record.route_length = route_stat->meters_route_length;
+				record.curvature = route_stat->curvature;
+			}
+			route_records.push_back(record);
+		}
+
+		vector<flat_base::DistanceRecord> distance_records;
+		for (const auto& distance : tc_.GetAllDistances()){
+			distance_records.push_back({ stop_indexes_.at(distance.from), stop_indexes_.at(distance.to), static_cast<uint32_t>(distance.meters) });
+		}
+
+		proto_all_settings_.Clear();
+		SerializeRendererSettings();
+		SerializeRenderedMap();
+		SerializeRouterSettings();
+
+		writer.SetSection(flat_base::Section::STOPS, stop_records);
+		writer.SetSection(flat_base::Section::ROUTES, route_records);
+		writer.SetSection(flat_base::Section::ROUTE_STOPS, route_stops);
+		writer.SetSection(flat_base::Section::ROUTE_DEPARTURES, route_departures);
+		writer.SetSection(flat_base::Section::DISTANCES, distance_records);
+		writer.SetSection(flat_base::Section::SETTINGS, proto_all_settings_.SerializeAsString());
+		SerializeFlatRouter(writer);
+		writer.Write(out);
+	}
+
+	void Serializer::SerializeFlatRouter(flat_base::Writer& writer){
+		if (tr_ == nullptr || !tr_->IsGraphBuilt()){
+			return;
+		}
+		const graph::DirectedWeightedGraph<double>& dw_graph = tr_->GetGraph();
+		vector<flat_base::EdgeRecord> edge_records;
+		edge_records.reserve(dw_graph.GetEdgeCount());
+		for (graph::EdgeId edge_id = 0; edge_id < dw_graph.GetEdgeCount(); ++edge_id){
+			const auto& edge = dw_graph.GetEdge(edge_id);
+			flat_base::EdgeRecord record;
+			record.from = static_cast<uint32_t>(edge.from);
+			record.to = static_cast<uint32_t>(edge.to);
+			record.weight = edge.weight;
+			if (edge.type == graph::EdgeType::WAIT){
+				record.kind = flat_base::EdgeKind::WAIT;
+				record.name_index = stop_indexes_.at(tc_.GetStopByName(edge.edge_name));
+			}
+			else{
+				record.kind = flat_base::EdgeKind::TRAVEL;
+				record.name_index = route_indexes_.at(edge.edge_name);
+			}
+			record.span_count = edge.span_count;
+			edge_records.push_back(record);
+		}
+
+		vector<flat_base::VertexesRecord> vertexes_records(stop_indexes_.size());
+		for (const auto& [stop, stop_index] : stop_indexes_){
+			vertexes_records[stop_index] = { static_cast<uint32_t>(tr_->GetWaitVertexes().at(stop->name)),
+				static_cast<uint32_t>(tr_->GetTravelVertexes().at(stop->name)) };
+		}
+
+		writer.SetVertexCount(dw_graph.GetVertexCount());
+		writer.SetSection(flat_base::Section::EDGES, edge_records);
+		writer.SetSection(flat_base::Section::VERTEXES, vertexes_records);
+		if (!tr_->IsBuilt()){
+			return;
+		}
+		if (const auto* fw_router = dynamic_cast<const router::FloydWarshallRouter*>(&tr_->GetRouter())){
+			// The table is the biggest part of the base, it is written right from the router.
+			const router::RoutesStorage& routes_internal_data = fw_router->GetRoutesInternalData();
+			const size_t cells_count = routes_internal_data.GetVertexCount() * routes_internal_data.GetVertexCount();
+			writer.SetSectionView(flat_base::Section::ROUTER_WEIGHTS,
+				flat_base::AsBytes(routes_internal_data.GetWeights(), cells_count));
+			writer.SetSectionView(flat_base::Section::ROUTER_PREV_EDGES,
+				flat_base::AsBytes(routes_internal_data.GetPrevEdges(), cells_count));
+		}
+		else if (const auto* ch_router = dynamic_cast<const graph::ContractionHierarchyRouter<double>*>(&tr_->GetRouter())){
+			const auto& hierarchy = ch_router->GetHierarchy();
+			const vector<uint32_t> ranks(hierarchy.ranks.begin(), hierarchy.ranks.end());
+			vector<flat_base::ShortcutRecord> shortcut_records;
+			shortcut_records.reserve(hierarchy.shortcuts.size());
+			for (const auto& shortcut : hierarchy.shortcuts){
+				shortcut_records.push_back({ static_cast<uint32_t>(shortcut.from), static_cast<uint32_t>(shortcut.to), shortcut.weight,
+					static_cast<uint32_t>(shortcut.first_edge), static_cast<uint32_t>(shortcut.second_edge) });
+			}
+			writer.SetSection(flat_base::Section::CH_RANKS, ranks);
+			writer.SetSection(flat_base::Section::CH_SHORTCUTS, shortcut_records);
+		}
+	}
+
+	// The catalogue and the graph own their data, so they are still rebuilt from the records and the
+	// start-up grows linearly with the stops, distances and edges. Only the router table is used in place.
+	void Serializer::DeserializeFlatCatalogue(){
+		const flat_base::View& view = *flat_base_;
+		stops_by_index_.clear();
+		routes_by_index_.clear();
+		for (const auto& record : view.GetSection<flat_base::StopRecord>(flat_base::Section::STOPS)){
+			const string_view name = view.GetString(record.name);
+			stops_by_index_.push_back(tc_.AddStop(transport_catalogue::Stop(name, record.lat, record.lng)));
+		}
+		for (const auto& record : view.GetSection<flat_base::DistanceRecord>(flat_base::Section::DISTANCES)){
+			tc_.AddDistance(GetStopByIndex(record.from), GetStopByIndex(record.to), record.distance);
+		}
+
+		const auto route_stops = view.GetSection<uint32_t>(flat_base::Section::ROUTE_STOPS);
+		const size_t route_stops_count = flat_base::GetSize(route_stops);
+		const auto route_departures = view.GetSection<double>(flat_base::Section::ROUTE_DEPARTURES);
+		const size_t route_departures_count = flat_base::GetSize(route_departures);
+		for (const auto& record : view.GetSection<flat_base::RouteRecord>(flat_base::Section::ROUTES)){
+			if (record.stops_begin > route_stops_count || record.stops_count > route_stops_count - record.stops_begin){
+				throw runtime_error("Corrupted flat base: route stops out of the section");
+			}
+			if (record.departures_begin > route_departures_count || record.departures_count > route_departures_count - record.departures_begin){
+				throw runtime_error("Corrupted flat base: route departures out of the section");
+			}
+			const string_view name = view.GetString(record.name);
+			transport_catalogue::Route route;
+			route.route_name = name;
+			route.is_circular = record.is_circular != 0;
+			route.stops.reserve(record.is_circular ? record.stops_count : 2 * record.stops_count);
+			for (uint32_t i = 0; i < record.stops_count; ++i){
+				route.stops.push_back(GetStopByIndex(route_stops.begin()[record.stops_begin + i]));
+			}
+			route.departures.assign(route_departures.begin() + record.departures_begin,
+				route_departures.begin() + record.departures_begin + record.departures_count);
+			routes_by_index_.push_back(tc_.AddRoute(std::move(route)));
+			tc_.AddRouteStat(transport_catalogue::RouteStat(record.stop_count, record.unique_stop_count,
+				record.route_length, record.curvature, name));
+		}
+		tc_.Finalize();
+
+		const string_view settings = view.GetBytes(flat_base::Section::SETTINGS);
+		if (!proto_all_settings_.ParseFromArray(settings.data(), static_cast<int>(settings.size()))){
+			throw runtime_error("Corrupted flat base: settings");
+		}
+	}
+
+	void Serializer::DeserializeFlatRouterData(){
+		const flat_base::View& view = *flat_base_;
+		const size_t vertex_count = view.GetVertexCount();
+		if (vertex_count == 0){
+			return;
+		}
+		graph::DirectedWeightedGraph<double> dw_graph(vertex_count);
+		for (const auto& record : view.GetSection<flat_base::EdgeRecord>(flat_base::Section::EDGES)){
+			if (record.from >= vertex_count || record.to >= vertex_count){
+				throw runtime_error("Corrupted flat base: edge out of the graph");
+			}
+			string_view edge_name;
+			if (record.kind == flat_base::EdgeKind::WAIT){
+				edge_name = GetStopByIndex(record.name_index)->name;
+			}
+			else{
+				edge_name = GetRouteByIndex(record.name_index)->route_name;
+			}
+			dw_graph.AddEdge({
+				record.from,
+				record.to,
+				record.weight,
+				edge_name,
+				record.kind == flat_base::EdgeKind::WAIT ? graph::EdgeType::WAIT : graph::EdgeType::TRAVEL,
+				record.span_count
+				});
+		}
+
+		const auto vertexes = view.GetSection<flat_base::VertexesRecord>(flat_base::Section::VERTEXES);
+		if (flat_base::GetSize(vertexes) != stops_by_index_.size()){
+			throw runtime_error("Corrupted flat base: vertexes do not match the stops");
+		}
+		router::VertexesMap vertexes_wait;
+		router::VertexesMap vertexes_travel;
+		for (size_t stop_index = 0; stop_index < stops_by_index_.size(); ++stop_index){
+			const flat_base::VertexesRecord& record = vertexes.begin()[stop_index];
+			vertexes_wait.insert({ stops_by_index_[stop_index]->name, record.wait });
+			vertexes_travel.insert({ stops_by_index_[stop_index]->name, record.travel });
+		}
+		tr_->ApplyGraph(std::move(dw_graph), std::move(vertexes_wait), std::move(vertexes_travel));
+
+		const router::RouterEngine router_engine = tr_->GetRouterSettings().router_engine;
+		const auto weights = view.GetSection<router::RoutesStorage::StoredWeightType>(flat_base::Section::ROUTER_WEIGHTS);
+		const auto prev_edges = view.GetSection<router::RoutesStorage::EdgeIndexType>(flat_base::Section::ROUTER_PREV_EDGES);
+		const auto ranks = view.GetSection<uint32_t>(flat_base::Section::CH_RANKS);
+		if (router_engine == router::RouterEngine::FLOYD_WARSHALL && flat_base::GetSize(weights) > 0){
+			if (flat_base::GetSize(weights) != vertex_count * vertex_count || flat_base::GetSize(prev_edges) != flat_base::GetSize(weights)){
+				throw runtime_error("Corrupted router data");
+			}
+			// The table is not copied: the router reads it from the mapped file.
+			tr_->ApplyRoutesInternalData(router::RoutesStorage(vertex_count, weights.begin(), prev_edges.begin(), view.GetFile()));
+		}
+		else if (router_engine == router::RouterEngine::CONTRACTION_HIERARCHIES && flat_base::GetSize(ranks) > 0){
+			graph::ContractionHierarchyRouter<double>::Hierarchy hierarchy;
+			hierarchy.ranks.assign(ranks.begin(), ranks.end());
+			for (const auto& record : view.GetSection<flat_base::ShortcutRecord>(flat_base::Section::CH_SHORTCUTS)){
+				hierarchy.shortcuts.push_back({ record.from, record.to, record.weight, record.first_edge, record.second_edge });
+			}
+			tr_->ApplyContractionHierarchy(std::move(hierarchy));
+		}
+		else{
+			tr_->BuildRouter();
+		}
+	}
+
+	const transport_catalogue::Stop* Serializer::GetStopByIndex(uint32_t stop_index) const{
+		if (stop_index >= stops_by_index_.size()){
+			throw runtime_error("Base references unknown stop " + to_string(stop_index));
+		}
+		return stops_by_index_[stop_index];
+	}
+
+	const transport_catalogue::Route* Serializer::GetRouteByIndex(uint32_t route_index) const{
+		if (route_index >= routes_by_index_.size()){
+			throw runtime_error("Base references unknown route " + to_string(route_index));
+		}
+		return routes_by_index_[route_index];
+	}
 }
\ No newline at end of file
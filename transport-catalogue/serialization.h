@@ -5,19 +5,39 @@
 #include "svg.h"
 #include "transport_router.h"
 #include "graph.h"
+#include "flat_base.h"
+#include "mapped_file.h"
 #include "transport_catalogue.pb.h"
 
+#include <cstdint>
 #include <fstream>
+#include <memory>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 #include <stdexcept>
 
 namespace serialization{
+	enum class BaseFormat{
+		PROTOBUF,
+		// Fixed-layout sections used in place from the mapped file, see flat_base.h.
+		FLAT,
+	};
+
+	struct SerializationSettings{
+		std::string file;
+		BaseFormat format = BaseFormat::PROTOBUF;
+		// Renders the map in make_base and stores it in the base, so process_requests only copies it.
+		bool store_rendered_map = false;
+	};
+
 	class Serializer{
 	public:
 		Serializer(transport_catalogue::TransportCatalogue& tc,
 			map_renderer::MapRenderer& mr,
 			router::TransportRouter* tr = nullptr);
-		void Serialize(const std::string& filename);
+		void Serialize(const std::string& filename, BaseFormat format = BaseFormat::PROTOBUF);
+		// Reads a base of any format, the format is recognized by the contents.
 		void Deserialize(const std::string& filename);
 		void DeserializeRouter(router::TransportRouter* tr);
 	private:
@@ -25,18 +45,50 @@ namespace serialization{
 		transport_catalogue::TransportCatalogue& tc_;
 		router::TransportRouter* tr_ = nullptr;   
 		proto_serialization::TransportCatalogue proto_all_settings_;
+		std::optional<flat_base::View> flat_base_;
+		// Stops and routes by their indexes in the base and the way back; bases of version 2
+		// and flat ones refer to stops and routes by these indexes.
+		std::vector<const transport_catalogue::Stop*> stops_by_index_;
+		std::vector<const transport_catalogue::Route*> routes_by_index_;
+		std::unordered_map<const transport_catalogue::Stop*, std::uint32_t> stop_indexes_;
+		std::unordered_map<std::string_view, std::uint32_t> route_indexes_;
+
+		void IndexCatalogue();
+		const transport_catalogue::Stop* GetStopByIndex(std::uint32_t stop_index) const;
+		const transport_catalogue::Route* GetRouteByIndex(std::uint32_t route_index) const;
 
         void SerializeDistance();
 		void SerializeRoute();
 		void SerializeStop();
 		proto_serialization::Color SerializeColor(const svg::Color& color);
 		void SerializeRendererSettings();
+		void SerializeRenderedMap();
 		void SerializeRouterSettings();
+		void SerializeRouter();
+		proto_serialization::Graph SerializeGraph(const graph::DirectedWeightedGraph<double>& dw_graph);
+		proto_serialization::Router SerializeRoutesInternalData(const router::RoutesStorage& routes_internal_data);
+		proto_serialization::ContractionHierarchy SerializeContractionHierarchy(
+			const graph::ContractionHierarchyRouter<double>::Hierarchy& hierarchy);
+		proto_serialization::RouterEngine SerializeRouterEngine(router::RouterEngine router_engine);
+		graph::ContractionHierarchyRouter<double>::Hierarchy DeserializeContractionHierarchy(
+			const proto_serialization::ContractionHierarchy& proto_hierarchy);
+		router::RouterEngine DeserializeRouterEngine(proto_serialization::RouterEngine proto_router_engine);
 
 		void DeserializeCatalogue();
+		void DeserializeCatalogueV2();
 		void DeserializeRenderer();
 		map_renderer::RendererSettings DeserializeRendererSettings(const proto_serialization::RendererSettings& proto_renderer_settings);
 		svg::Color DeserializeColor(const proto_serialization::Color& color_ser);
+		void DeserializeRouterData();
+		graph::DirectedWeightedGraph<double> DeserializeGraph(const proto_serialization::Graph& proto_graph);
+		std::string_view DeserializeEdgeName(const proto_serialization::Edge& proto_edge) const;
+		router::RoutesStorage DeserializeRoutesInternalData(const proto_serialization::Router& proto_router,
+			size_t vertex_count);
+
+		void SerializeFlat(std::ostream& out);
+		void SerializeFlatRouter(flat_base::Writer& writer);
+		void DeserializeFlatCatalogue();
+		void DeserializeFlatRouterData();
 	};
 
 } 
\ No newline at end of file
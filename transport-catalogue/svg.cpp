@@ -1,41 +1,140 @@
 #include "svg.h"
+
+#include <charconv>
 using namespace std;
 namespace svg{
 
-ostream& operator<<(ostream& out, const StrokeLineCap& line_cap){
-   switch (line_cap){
+namespace{
+    string_view ToStringView(StrokeLineCap line_cap){
+        switch (line_cap){
         case StrokeLineCap::BUTT:
-            out << "butt"sv;
-            break;
+            return "butt"sv;
         case StrokeLineCap::ROUND:
-            out << "round"sv;
-            break;
+            return "round"sv;
         case StrokeLineCap::SQUARE:
-            out << "square"sv;
-            break;
+            return "square"sv;
         }
-        return out;
+        return {};
     }
 
-    ostream& operator<<(ostream& out, const StrokeLineJoin& line_join){
+    string_view ToStringView(StrokeLineJoin line_join){
         switch (line_join){
         case StrokeLineJoin::ARCS:
-            out << "arcs"sv;
-            break;
+            return "arcs"sv;
         case StrokeLineJoin::BEVEL:
-            out << "bevel"sv;
-            break;
+            return "bevel"sv;
         case StrokeLineJoin::MITER:
-            out << "miter"sv;
-            break;
+            return "miter"sv;
         case StrokeLineJoin::MITER_CLIP:
-            out << "miter-clip"sv;
-            break;
+            return "miter-clip"sv;
         case StrokeLineJoin::ROUND:
-            out << "round"sv;
-            break;
+            return "round"sv;
+        }
+        return {};
+    }
+
+    struct BufferColorPrinter{
+        OutputBuffer& out;
+        void operator()(std::monostate) const
+        {}
+        void operator()(const std::string& str) const
+        {
+            out << str;
+        }
+        void operator()(Rgb rgb) const
+        {
+            out << "rgb("sv << uint32_t{ rgb.red } << ',' << uint32_t{ rgb.green } << ',' << uint32_t{ rgb.blue } << ')';
+        }
+        void operator()(Rgba rgba) const
+        {
+            out << "rgba("sv << uint32_t{ rgba.red } << ',' << uint32_t{ rgba.green } << ',' << uint32_t{ rgba.blue } << ','
+                << rgba.opacity << ')';
+        }
+    };
+
+    // Escapes the characters that have a special meaning in XML text.
+    void RenderEncoded(OutputBuffer& out, string_view data){
+        for (const char c : data){
+            switch (c){
+            case '&':
+                out << "&amp;"sv;
+                break;
+            case '"':
+                out << "&quot;"sv;
+                break;
+            case '\'':
+                out << "&apos;"sv;
+                break;
+            case '<':
+                out << "&lt;"sv;
+                break;
+            case '>':
+                out << "&gt;"sv;
+                break;
+            default:
+                out << c;
+                break;
+            }
         }
-        return out;
+    }
+}
+
+    ostream& operator<<(ostream& out, const StrokeLineCap& line_cap){
+        return out << ToStringView(line_cap);
+    }
+
+    ostream& operator<<(ostream& out, const StrokeLineJoin& line_join){
+        return out << ToStringView(line_join);
+    }
+
+    OutputBuffer& OutputBuffer::operator<<(string_view text){
+        buffer_ += text;
+        return *this;
+    }
+
+    OutputBuffer& OutputBuffer::operator<<(const string& text){
+        return *this << string_view(text);
+    }
+
+    OutputBuffer& OutputBuffer::operator<<(const char* text){
+        return *this << string_view(text);
+    }
+
+    OutputBuffer& OutputBuffer::operator<<(char c){
+        buffer_ += c;
+        return *this;
+    }
+
+    OutputBuffer& OutputBuffer::operator<<(double value){
+        // Default stream precision is 6 significant digits in the general format.
+        char digits[32];
+        const auto result = to_chars(begin(digits), end(digits), value, chars_format::general, 6);
+        buffer_.append(digits, result.ptr);
+        return *this;
+    }
+
+    OutputBuffer& OutputBuffer::operator<<(uint32_t value){
+        char digits[16];
+        const auto result = to_chars(begin(digits), end(digits), value);
+        buffer_.append(digits, result.ptr);
+        return *this;
+    }
+
+    OutputBuffer& OutputBuffer::operator<<(const Color& color){
+        visit(BufferColorPrinter{ *this }, color);
+        return *this;
+    }
+
+    OutputBuffer& OutputBuffer::operator<<(StrokeLineCap line_cap){
+        return *this << ToStringView(line_cap);
+    }
+
+    OutputBuffer& OutputBuffer::operator<<(StrokeLineJoin line_join){
+        return *this << ToStringView(line_join);
+    }
+
+    void OutputBuffer::Put(char c, size_t count){
+        buffer_.append(count, c);
     }
 
     void Object::Render(const RenderContext& context) const{
@@ -115,30 +214,6 @@ ostream& operator<<(ostream& out, const StrokeLineCap& line_cap){
         return *this;
     }
 
-    static unordered_map<char, string> html_symbols = {
-        {'&', std::string("&amp;")},
-        {'\"', std::string("&quot;")},
-        {'\'', std::string("&apos;")},
-        {'<', std::string("&lt;")},
-        {'>', std::string("&gt;")}
-    };
-
-   string Text::Encode(std::string data) const{
-        string substring;
-        string replace_to;
-        size_t pos = 0;
-        for (const auto& [key, value] : html_symbols)
-        {
-            pos = data.find(key);
-            while (pos != string::npos)
-            {
-                data.replace(pos, sizeof(key), value);
-                pos = data.find(substring, pos + value.size());
-            }
-        }
-        return data;
-    }
-
     void Text::RenderObject(const RenderContext& context) const{
         auto& out = context.out;
         out << "<text"sv;
@@ -153,21 +228,28 @@ ostream& operator<<(ostream& out, const StrokeLineCap& line_cap){
         }
         RenderAttrs(out);
         out << ">"sv;
-        out << Encode(data_);
+        RenderEncoded(out, data_);
         out << "</text>"sv;
     }
 
-    void Document::Render(ostream& out) const{ 
+    void Document::Render(ostream& out) const{
+        string buffer;
+        Render(buffer);
+        out << buffer;
+    }
+
+    void Document::Render(string& buffer) const{
+        OutputBuffer out(buffer);
         RenderContext context_ = RenderContext(out);
-        out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << endl;
-        out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << endl;
+        out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << '\n';
+        out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << '\n';
         context_.indent += context_.indent_step;
         for (size_t i = 0; i < objects_.size(); ++i)
         {
             objects_[i]->Render(context_);
-            out << std::endl;
+            out << '\n';
         }
         context_.indent -= context_.indent_step;
         out << "</svg>"sv;
     }
-} 
\ No newline at end of file
+}
\ No newline at end of file
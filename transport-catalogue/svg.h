@@ -80,6 +80,26 @@ namespace svg{
     std::ostream& operator<<(std::ostream& out, const StrokeLineCap& line_cap);
     std::ostream& operator<<(std::ostream& out, const StrokeLineJoin& line_join);
 
+    // Growable byte buffer a document is rendered into. Numbers are formatted by std::to_chars
+    // the same way as std::ostream with the default precision, so the text matches the stream one.
+    class OutputBuffer{
+    public:
+        explicit OutputBuffer(std::string& buffer) : buffer_(buffer)
+        {}
+        OutputBuffer& operator<<(std::string_view text);
+        OutputBuffer& operator<<(const std::string& text);
+        OutputBuffer& operator<<(const char* text);
+        OutputBuffer& operator<<(char c);
+        OutputBuffer& operator<<(double value);
+        OutputBuffer& operator<<(uint32_t value);
+        OutputBuffer& operator<<(const Color& color);
+        OutputBuffer& operator<<(StrokeLineCap line_cap);
+        OutputBuffer& operator<<(StrokeLineJoin line_join);
+        void Put(char c, size_t count);
+    private:
+        std::string& buffer_;
+    };
+
     template <typename Owner>
     class PathProps{
     public:
@@ -106,17 +126,13 @@ namespace svg{
 
     protected:
         ~PathProps() = default;
-        void RenderAttrs(std::ostream& out) const{
+        void RenderAttrs(OutputBuffer& out) const{
             using namespace std::literals;
             if (fill_color_){
-                out << " fill=\""sv;
-                visit(OstreamSolutionPrinter{ out }, *fill_color_);
-                out << "\""sv;
+                out << " fill=\""sv << *fill_color_ << "\""sv;
             }
             if (stroke_color_){
-                out << " stroke=\""sv;
-                visit(OstreamSolutionPrinter{ out }, *stroke_color_);
-                out << "\""sv;
+                out << " stroke=\""sv << *stroke_color_ << "\""sv;
             }
             if (width_){
                 out << " stroke-width=\""sv << *width_ << "\""sv;
@@ -151,11 +167,11 @@ namespace svg{
     };
 
     struct RenderContext{
-        RenderContext(std::ostream& out)
+        RenderContext(OutputBuffer& out)
             : out(out)
         {}
 
-        RenderContext(std::ostream& out, int indent_step, int indent = 0)
+        RenderContext(OutputBuffer& out, int indent_step, int indent = 0)
             : out(out)
             , indent_step(indent_step)
             , indent(indent)
@@ -166,11 +182,9 @@ namespace svg{
         }
 
         void RenderIndent() const{
-            for (int i = 0; i < indent * indent_step; ++i){
-                out.put(' ');
-            }
+            out.Put(' ', indent * indent_step);
         }
-        std::ostream& out;
+        OutputBuffer& out;
         int indent_step = 1;
         int indent = 0;
     };
@@ -226,7 +240,6 @@ namespace svg{
         Text& SetFontWeight(std::string font_weight);
         Text& SetData(std::string data);
     private:
-        std::string Encode(std::string data) const;
         void RenderObject(const RenderContext& context) const override;
         Point position_;
         Point offset_;
@@ -247,6 +260,8 @@ namespace svg{
             objects_.push_back(std::move(obj));
         }
         void Render(std::ostream& out) const;
+        // Appends the document to the buffer; the same text as Render to a stream.
+        void Render(std::string& buffer) const;
     private:
         std::vector<std::unique_ptr<Object>> objects_;
     };
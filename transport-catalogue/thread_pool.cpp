@@ -0,0 +1,93 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+using namespace std;
+namespace concurrency{
+	ThreadPool::ThreadPool(size_t threads_count){
+		threads_count = max<size_t>(threads_count, 1);
+		workers_.reserve(threads_count);
+		for (size_t i = 0; i < threads_count; ++i){
+			workers_.emplace_back([this]{
+				WorkerLoop();
+			});
+		}
+	}
+
+	ThreadPool::~ThreadPool(){
+		{
+			lock_guard lock(mutex_);
+			stopping_ = true;
+		}
+		tasks_cv_.notify_all();
+		for (auto& worker : workers_){
+			worker.join();
+		}
+	}
+
+	size_t ThreadPool::DefaultThreadsCount(){
+		return max<size_t>(thread::hardware_concurrency(), 1);
+	}
+
+	size_t ThreadPool::GetThreadsCount() const{
+		return workers_.size();
+	}
+
+	void ThreadPool::ParallelFor(size_t count, const function<void(size_t)>& body){
+		if (count == 0){
+			return;
+		}
+		atomic<size_t> next_index{ 0 };
+		auto run = [&next_index, &body, count]{
+			for (size_t i = next_index++; i < count; i = next_index++){
+				body(i);
+			}
+		};
+		vector<future<void>> runners;
+		const size_t runners_count = min(count, workers_.size());
+		runners.reserve(runners_count);
+		for (size_t i = 0; i < runners_count; ++i){
+			runners.push_back(Submit(run));
+		}
+		exception_ptr error;
+		for (auto& runner : runners){
+			try{
+				runner.get();
+			}
+			catch (...){
+				if (!error){
+					error = current_exception();
+				}
+			}
+		}
+		if (error){
+			rethrow_exception(error);
+		}
+	}
+
+	void ThreadPool::Enqueue(function<void()> task){
+		{
+			lock_guard lock(mutex_);
+			tasks_.push_back(move(task));
+		}
+		tasks_cv_.notify_one();
+	}
+
+	void ThreadPool::WorkerLoop(){
+		while (true){
+			function<void()> task;
+			{
+				unique_lock lock(mutex_);
+				tasks_cv_.wait(lock, [this]{
+					return stopping_ || !tasks_.empty();
+				});
+				if (tasks_.empty()){
+					return;
+				}
+				task = move(tasks_.front());
+				tasks_.pop_front();
+			}
+			task();
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace concurrency{
+    // Fixed set of worker threads executing submitted tasks in FIFO order.
+    // Tasks must not wait for other tasks of the same pool.
+    class ThreadPool{
+    public:
+        explicit ThreadPool(size_t threads_count = DefaultThreadsCount());
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ~ThreadPool();
+
+        static size_t DefaultThreadsCount();
+        size_t GetThreadsCount() const;
+
+        template <typename Task>
+        auto Submit(Task&& task) -> std::future<std::invoke_result_t<std::decay_t<Task>>>;
+
+        // Calls body(i) for every i in [0, count) on the workers and waits for all of them.
+        // The first exception thrown by body is rethrown in the caller.
+        void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    private:
+        void Enqueue(std::function<void()> task);
+        void WorkerLoop();
+
+        std::vector<std::thread> workers_;
+        std::deque<std::function<void()>> tasks_;
+        std::mutex mutex_;
+        std::condition_variable tasks_cv_;
+        bool stopping_ = false;
+    };
+
+    template <typename Task>
+    auto ThreadPool::Submit(Task&& task) -> std::future<std::invoke_result_t<std::decay_t<Task>>>{
+        using Result = std::invoke_result_t<std::decay_t<Task>>;
+        auto packaged_task = std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task));
+        std::future<Result> result = packaged_task->get_future();
+        Enqueue([packaged_task]{
+            (*packaged_task)();
+        });
+        return result;
+    }
+}
@@ -1,7 +1,12 @@
 #include "transport_catalogue.h"
 #include <algorithm>   
+#include <stdexcept>
 using namespace std;
 namespace transport_catalogue{
+	StopStat::StopStat(string_view stop_name) :
+		name(stop_name)
+	{}
+
 	StopStat::StopStat(string_view stop_name, set<string_view>& buses) :
 		name(stop_name), buses(buses)
 	{}
@@ -17,58 +22,131 @@ namespace transport_catalogue{
 	TransportCatalogue::TransportCatalogue(){}
 	TransportCatalogue::~TransportCatalogue(){}
 
-	void TransportCatalogue::AddStop(Stop&& stop){
-		if (all_stops_map_.count(GetStopName(&stop)) == 0){
-			auto& ref = all_stops_data_.emplace_back(move(stop));
-			all_stops_map_.insert({string_view(ref.name), &ref });
+	const Stop* TransportCatalogue::AddStop(Stop&& stop){
+		if (const auto it = all_stops_map_.find(GetStopName(&stop)); it != all_stops_map_.end()){
+			return it->second;
 		}
+		stop.name = names_.Intern(stop.name);
+		stop.id = all_stops_data_.size();
+		auto& ref = all_stops_data_.emplace_back(move(stop));
+		all_stops_map_.insert({ref.name, &ref });
+		stops_stat_.emplace(ref.name, StopStat(ref.name));
+		return &ref;
 	}
 
-	void TransportCatalogue::AddRoute(Route&& route){
-		if (all_buses_map_.count(route.route_name) == 0){
-			auto& ref = all_buses_data_.emplace_back(move(route));
-			all_buses_map_.insert({string_view(ref.route_name), &ref });
-			vector<const Stop*> tmp = ref.stops;
-			sort(tmp.begin(), tmp.end());
-			auto last = unique(tmp.begin(), tmp.end());
-			ref.unique_stops_qty = (last != tmp.end() ? std::distance(tmp.begin(), last) : tmp.size());
-			if (!ref.is_circular){
-				for (int i = ref.stops.size() - 2; i >= 0; --i){
-					ref.stops.push_back(ref.stops[i]);
-				}
+	const Route* TransportCatalogue::AddRoute(Route&& route){
+		if (const auto it = all_buses_map_.find(route.route_name); it != all_buses_map_.end()){
+			return it->second;
+		}
+		route.route_name = names_.Intern(route.route_name);
+		auto& ref = all_buses_data_.emplace_back(move(route));
+		all_buses_map_.insert({ref.route_name, &ref });
+		for (const Stop* stop : ref.stops){
+			stops_stat_.at(stop->name).buses.insert(ref.route_name);
+		}
+		if (!ref.is_circular){
+			for (int i = ref.stops.size() - 2; i >= 0; --i){
+				ref.stops.push_back(ref.stops[i]);
 			}
-			int stops_num = static_cast<int>(ref.stops.size());
-			if (stops_num > 1){
-				ref.geo_route_length = 0;
-				ref.meters_route_length = 0;
-				for (int i = 0; i < stops_num - 1; ++i){
-					ref.geo_route_length += ComputeDistance(ref.stops[i]->coords, ref.stops[i + 1]->coords);
-					ref.meters_route_length += GetDistance(ref.stops[i], ref.stops[i + 1]);
-				}
-				ref.curvature = ref.meters_route_length / ref.geo_route_length;
+		}
+		return &ref;
+	}
+
+	void TransportCatalogue::AddRouteStat(const RouteStat& route_stat){
+		const Route* ptr = GetRouteByName(route_stat.name);
+		if (ptr == nullptr){
+			throw invalid_argument("Statistics of unknown route "s + string(route_stat.name));
+		}
+		RouteStat stored_stat = route_stat;
+		stored_stat.name = ptr->route_name;
+		routes_stat_.insert_or_assign(stored_stat.name, stored_stat);
+	}
+
+	void TransportCatalogue::Finalize(){
+		IndexDistances();
+		for (auto& route : all_buses_data_){
+			MeasureRoute(route);
+			if (routes_stat_.count(route.route_name) == 0){
+				routes_stat_.emplace(route.route_name, ComputeRouteStat(route));
 			}
-			else{
-				ref.geo_route_length = 0;
-				ref.meters_route_length = 0;
-				ref.curvature = 1;
+		}
+	}
+
+	void TransportCatalogue::IndexDistances(){
+		if (new_distances_.empty() && distance_offsets_.size() == all_stops_data_.size() + 1){
+			return;
+		}
+		// The indexed distances were added earlier, so they stay first among equal pairs.
+		vector<Distance> distances = GetAllDistances();
+		distances.insert(distances.end(), new_distances_.begin(), new_distances_.end());
+		new_distances_.clear();
+		stable_sort(distances.begin(), distances.end(), [](const Distance& lhs, const Distance& rhs){
+			return make_pair(lhs.from->id, lhs.to->id) < make_pair(rhs.from->id, rhs.to->id);
+		});
+		distances.erase(unique(distances.begin(), distances.end(), [](const Distance& lhs, const Distance& rhs){
+			return lhs.from == rhs.from && lhs.to == rhs.to;
+		}), distances.end());
+
+		distance_offsets_.assign(all_stops_data_.size() + 1, 0);
+		distance_targets_.clear();
+		distance_meters_.clear();
+		distance_targets_.reserve(distances.size());
+		distance_meters_.reserve(distances.size());
+		for (const Distance& distance : distances){
+			++distance_offsets_[distance.from->id + 1];
+			distance_targets_.push_back(static_cast<uint32_t>(distance.to->id));
+			distance_meters_.push_back(static_cast<uint32_t>(distance.meters));
+		}
+		for (size_t stop_id = 0; stop_id < all_stops_data_.size(); ++stop_id){
+			distance_offsets_[stop_id + 1] += distance_offsets_[stop_id];
+		}
+	}
+
+	void TransportCatalogue::MeasureRoute(Route& route) const{
+		route.distances_from_start.assign(route.stops.size(), 0);
+		for (size_t i = 1; i < route.stops.size(); ++i){
+			route.distances_from_start[i] = route.distances_from_start[i - 1] + GetDistance(route.stops[i - 1], route.stops[i]);
+		}
+	}
+
+	RouteStat TransportCatalogue::ComputeRouteStat(const Route& route) const{
+		vector<const Stop*> tmp = route.stops;
+		sort(tmp.begin(), tmp.end());
+		const size_t unique_stops = distance(tmp.begin(), unique(tmp.begin(), tmp.end()));
+		double geo_route_length = 0;
+		size_t meters_route_length = 0;
+		double curvature = 1;
+		const int stops_num = static_cast<int>(route.stops.size());
+		if (stops_num > 1){
+			for (int i = 0; i < stops_num - 1; ++i){
+				geo_route_length += ComputeDistance(route.stops[i]->coords, route.stops[i + 1]->coords);
 			}
+			meters_route_length = route.distances_from_start.back();
+			curvature = meters_route_length / geo_route_length;
 		}
+		return RouteStat(route.stops.size(), unique_stops, meters_route_length, curvature, route.route_name);
 	}
 
 	void TransportCatalogue::AddDistance(const Stop*stop_from, const Stop*stop_to, size_t dist){
 		if (stop_from != nullptr && stop_to != nullptr){
-			distances_map_.insert({ { stop_from, stop_to }, dist });
+			new_distances_.push_back({ stop_from, stop_to, dist });
 		}
 	}
 
-	size_t TransportCatalogue::GetDistance(const Stop*stop_from, const Stop*stop_to){
+	size_t TransportCatalogue::GetDistance(const Stop*stop_from, const Stop*stop_to) const{
 		size_t result = GetDistanceDirectly(stop_from, stop_to);
 		return (result > 0 ? result : GetDistanceDirectly(stop_to, stop_from));
 	}
 
-	size_t TransportCatalogue::GetDistanceDirectly(const Stop*stop_from, const Stop*stop_to){
-		if (distances_map_.count({ stop_from, stop_to }) > 0){
-			return distances_map_.at({ stop_from, stop_to });
+	size_t TransportCatalogue::GetDistanceDirectly(const Stop*stop_from, const Stop*stop_to) const{
+		if (stop_from->id + 1 >= distance_offsets_.size()){
+			throw logic_error("Transport catalogue is not finalized");
+		}
+		const auto targets_begin = distance_targets_.begin() + distance_offsets_[stop_from->id];
+		const auto targets_end = distance_targets_.begin() + distance_offsets_[stop_from->id + 1];
+		const auto target = lower_bound(targets_begin, targets_end, stop_to->id);
+		if (target != targets_end && *target == stop_to->id){
+			return distance_meters_[target - distance_targets_.begin()];
 		}
 		else{
 			return 0;
@@ -88,7 +166,7 @@ namespace transport_catalogue{
 	}
 
 	string_view TransportCatalogue::GetBusName(const Route route){
-		return string_view(route.route_name);
+		return route.route_name;
 	}
 
 	const Stop*TransportCatalogue::GetStopByName(const string_view stop_name) const{
@@ -101,15 +179,14 @@ namespace transport_catalogue{
 	}
 
 	RouteStatPtr TransportCatalogue::GetRouteInfo(const string_view route_name) const{
-		const Route* ptr = GetRouteByName(route_name);
-		if (ptr == nullptr){
-			return nullptr;
+		const auto route_stat = routes_stat_.find(route_name);
+		if (route_stat != routes_stat_.end()){
+			return &route_stat->second;
 		}
-		return new RouteStat(ptr->stops.size(),
-			ptr->unique_stops_qty,
-			ptr->meters_route_length,
-			ptr->curvature,
-			ptr->route_name);
+		if (GetRouteByName(route_name) != nullptr){
+			throw logic_error("Transport catalogue is not finalized");
+		}
+		return nullptr;
 	}
     
     const Route* TransportCatalogue::GetRouteByName(const string_view bus_name) const{
@@ -122,25 +199,14 @@ namespace transport_catalogue{
 	}
     
 	StopStatPtr TransportCatalogue::GetBusesForStopInfo(const string_view stop_name) const{
-		const Stop*ptr = GetStopByName(stop_name);
-		if (ptr == nullptr){
+		const auto stop_stat = stops_stat_.find(stop_name);
+		if (stop_stat == stops_stat_.end()){
 			return nullptr;
 		}
-		set<string_view> found_buses;
-		for (const auto& bus : all_buses_map_){
-			auto tmp = find_if(bus.second->stops.begin(), bus.second->stops.end(),
-				[stop_name](const Stop* curr_stop)
-				{
-					return (curr_stop->name == stop_name);
-				});
-			if (tmp != bus.second->stops.end()){
-				found_buses.insert(bus.second->route_name);
-			}
-		}
-		return new StopStat(stop_name, found_buses);
+		return &stop_stat->second;
 	}
 
-	void TransportCatalogue::GetAllRoutes(map<const string, RendererData>& all_routes) const{
+	void TransportCatalogue::GetAllRoutes(map<string_view, RendererData>& all_routes) const{
 		for (const auto& route : all_buses_data_){
 			if (route.stops.size() > 0){
 				RendererData item;
@@ -149,7 +215,7 @@ namespace transport_catalogue{
 					item.stop_names.push_back(stop->name);
 				}
 				item.is_circular = route.is_circular;
-				all_routes.emplace(make_pair(route.route_name, item));
+				all_routes.emplace(route.route_name, move(item));
 			}
 		}
 		return;
@@ -179,8 +245,15 @@ namespace transport_catalogue{
 		return route_ptrs;
 	}
 
-	const unordered_map<pair<const Stop*, const Stop*>, size_t, Hasher>& TransportCatalogue::GetAllDistances() const{
-		return distances_map_;
+	vector<Distance> TransportCatalogue::GetAllDistances() const{
+		vector<Distance> distances;
+		distances.reserve(distance_targets_.size());
+		for (size_t stop_id = 0; stop_id + 1 < distance_offsets_.size(); ++stop_id){
+			for (uint32_t i = distance_offsets_[stop_id]; i < distance_offsets_[stop_id + 1]; ++i){
+				distances.push_back({ &all_stops_data_[stop_id], &all_stops_data_[distance_targets_[i]], distance_meters_[i] });
+			}
+		}
+		return distances;
 	}
 
 }
\ No newline at end of file
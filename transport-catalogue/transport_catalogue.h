@@ -1,7 +1,9 @@
 #pragma once
 #include "geo.h"          
 #include "domain.h"       
+#include "name_arena.h"
 
+#include <cstdint>
 #include <deque>
 #include <map>             
 #include <vector>
@@ -18,6 +20,7 @@
 
 namespace transport_catalogue{
 	struct StopStat{
+		explicit StopStat(std::string_view);
 		explicit StopStat(std::string_view, std::set<std::string_view>&);
 		std::string_view name;
 		std::set<std::string_view> buses;
@@ -30,44 +33,72 @@ namespace transport_catalogue{
 		size_t unique_stops = 0;
 		int64_t meters_route_length = 0;
 		double curvature = 0;
-		std::string name;
+		std::string_view name;
 	};
 	using RouteStatPtr = const RouteStat*;
 
+	struct Distance{
+		const Stop* from = nullptr;
+		const Stop* to = nullptr;
+		size_t meters = 0;
+	};
 
 
 class TransportCatalogue{
 public:
 		TransportCatalogue();
 		~TransportCatalogue();
-		void AddStop(Stop&&);
-		void AddRoute(Route&&);
+		// Return the stop or the route kept by the catalogue; the one added first if the name repeats.
+		const Stop* AddStop(Stop&&);
+		const Route* AddRoute(Route&&);
 		void AddDistance(const Stop*, const Stop*, size_t);
+		// Stores statistics computed earlier (e.g. read from a base) for an added route.
+		void AddRouteStat(const RouteStat&);
+		// Indexes the distances, measures the routes and computes statistics of every route that
+		// has none yet. Must be called after the last AddRoute/AddDistance and before GetDistance
+		// and GetRouteInfo.
+		void Finalize();
 
-		size_t GetDistance(const Stop*, const Stop*);
-		size_t GetDistanceDirectly(const Stop*, const Stop*);
+		// The distance from the first stop to the second one, or back if it is not set.
+		size_t GetDistance(const Stop*, const Stop*) const;
+		size_t GetDistanceDirectly(const Stop*, const Stop*) const;
 		const Stop* GetStopByName(const std::string_view) const;
 		const Route* GetRouteByName(const std::string_view) const;
 
 		RouteStatPtr GetRouteInfo(const std::string_view) const;
 		StopStatPtr GetBusesForStopInfo(const std::string_view) const;
 
-		void GetAllRoutes(std::map<const std::string, RendererData>&) const; 
+		void GetAllRoutes(std::map<std::string_view, RendererData>&) const; 
 		size_t GetAllStopsCount() const;
 		const std::vector<const Stop*> GetAllStopsPtr() const;
 		const std::deque<const Route*> GetAllRoutesPtr() const;
-		const std::unordered_map<std::pair<const Stop*, const Stop*>, size_t, Hasher>& GetAllDistances() const;
+		// The distances indexed by the last Finalize, sorted by the ids of the stops.
+		std::vector<Distance> GetAllDistances() const;
 
 private:
+		// Declared first, so the names outlive everything that refers to them.
+		NameArena names_;
 		std::deque<Stop> all_stops_data_;
 		std::unordered_map<std::string_view, const Stop*> all_stops_map_; 
 		std::deque<Route> all_buses_data_;
 		std::unordered_map<std::string_view, const Route*> all_buses_map_;
-		std::unordered_map<std::pair<const Stop*, const Stop*>, size_t, Hasher> distances_map_; 
+		// Buses passing through every stop, sorted by name; filled by AddRoute.
+		std::unordered_map<std::string_view, StopStat> stops_stat_;
+		std::unordered_map<std::string_view, RouteStat> routes_stat_;
+		// Added since the last Finalize; the first distance added between two stops wins.
+		std::vector<Distance> new_distances_;
+		// Distances from stop id i go to distance_targets_[j] for j in
+		// [distance_offsets_[i], distance_offsets_[i + 1]), sorted by the target ids.
+		std::vector<uint32_t> distance_offsets_;
+		std::vector<uint32_t> distance_targets_;
+		std::vector<uint32_t> distance_meters_;
 
 		std::string_view GetStopName(const Stop* stop_ptr);
 		std::string_view GetStopName(const Stop stop);
 		std::string_view GetBusName(const Route* route_ptr);
 		std::string_view GetBusName(const Route route);
+		void IndexDistances();
+		void MeasureRoute(Route&) const;
+		RouteStat ComputeRouteStat(const Route&) const;
 	};
 }
\ No newline at end of file
@@ -16,30 +16,194 @@ namespace router{
 		return settings_;
 	}
 
-	const RouteData TransportRouter::CalculateRoute(const string_view from, const string_view to){
-		if (!router_){
-			BuildGraph();
-		}
-		RouteData result;
-		auto calculated_route = router_->BuildRoute(vertexes_wait_.at(from), vertexes_wait_.at(to));
+	const RouteData TransportRouter::CalculateRoute(const string_view from, const string_view to) const{
+		auto calculated_route = GetRouter().BuildRoute(vertexes_wait_.at(from), vertexes_wait_.at(to));
 		if (calculated_route){
-			result.founded = true;
-			for (const auto& element_id : calculated_route->edges){
-				auto edge_details = dw_graph_.GetEdge(element_id);
-				result.total_time += edge_details.weight;
-				result.items.emplace_back(RouteItem{
-					edge_details.edge_name,
-					(edge_details.type == graph::EdgeType::TRAVEL) ? edge_details.span_count : 0,
-					edge_details.weight,
-					edge_details.type });
+			return MakeRouteData(calculated_route->edges);
+		}
+		return RouteData{};
+	}
+
+	vector<RouteData> TransportRouter::CalculateRoutes(string_view from, string_view to, size_t count) const{
+		if (count > MAX_ROUTE_ALTERNATIVES){
+			throw invalid_argument("Too many route alternatives");
+		}
+		vector<RouteData> routes;
+		const auto from_vertex = vertexes_wait_.find(from);
+		const auto to_vertex = vertexes_wait_.find(to);
+		if (from_vertex == vertexes_wait_.end() || to_vertex == vertexes_wait_.end() || count == 0){
+			return routes;
+		}
+		auto same_items = [](const RouteData& lhs, const RouteData& rhs){
+			return equal(lhs.items.begin(), lhs.items.end(), rhs.items.begin(), rhs.items.end(),
+				[](const RouteItem& lhs, const RouteItem& rhs){
+					return lhs.type == rhs.type && lhs.edge_name == rhs.edge_name && lhs.span_count == rhs.span_count;
+				});
+		};
+		// Loopless paths of the graph may still look the same to a passenger, e.g. the same bus
+		// entered at another pass of a circular route; such paths are skipped within a limit.
+		const size_t max_paths = count * 8;
+		graph::KShortestPaths<double> paths(dw_graph_, incoming_edges_, from_vertex->second, to_vertex->second);
+		for (size_t i = 0; i < max_paths && routes.size() < count; ++i){
+			const auto path = paths.Next();
+			if (!path){
+				break;
+			}
+			RouteData route = MakeRouteData(path->edges);
+			if (none_of(routes.begin(), routes.end(), [&](const RouteData& known){ return same_items(known, route); })){
+				routes.push_back(move(route));
 			}
 		}
+		return routes;
+	}
+
+	RouteData TransportRouter::CalculateTimetableRoute(string_view from, string_view to, double departure_time) const{
+		const transport_catalogue::Stop* from_stop = tc_.GetStopByName(from);
+		const transport_catalogue::Stop* to_stop = tc_.GetStopByName(to);
+		if (from_stop == nullptr || to_stop == nullptr){
+			return RouteData{};
+		}
+		const auto legs = GetTimetableRouter().FindJourney(from_stop, to_stop, departure_time);
+		if (!legs){
+			return RouteData{};
+		}
+		RouteData result;
+		result.founded = true;
+		double arrival = departure_time;
+		for (const JourneyLeg& leg : *legs){
+			result.items.emplace_back(RouteItem{ leg.from->name, 0, leg.departure - arrival, graph::EdgeType::WAIT });
+			result.items.emplace_back(RouteItem{ leg.route_name, leg.span_count, leg.arrival - leg.departure, graph::EdgeType::TRAVEL });
+			arrival = leg.arrival;
+		}
+		result.total_time = arrival - departure_time;
 		return result;
 	}
 
+	const ConnectionScanRouter& TransportRouter::GetTimetableRouter() const{
+		call_once(timetable_router_flag_, [this]{
+			timetable_router_ = make_unique<ConnectionScanRouter>(tc_, settings_.bus_velocity * METERS_IN_KILOMETR / MINUTES_IN_HOUR);
+		});
+		return *timetable_router_;
+	}
+
+	optional<TravelTimes> TransportRouter::CalculateTravelTimes(const vector<string_view>& from, const vector<string_view>& to) const{
+		auto get_vertexes = [this](const vector<string_view>& stops) -> optional<vector<graph::VertexId>>{
+			vector<graph::VertexId> vertexes;
+			vertexes.reserve(stops.size());
+			for (const string_view stop : stops){
+				const auto vertex = vertexes_wait_.find(stop);
+				if (vertex == vertexes_wait_.end()){
+					return nullopt;
+				}
+				vertexes.push_back(vertex->second);
+			}
+			return vertexes;
+		};
+		const auto sources = get_vertexes(from);
+		const auto targets = get_vertexes(to);
+		if (!sources || !targets){
+			return nullopt;
+		}
+		return TravelTimes{ from.size(), to.size(), GetRouter().GetRouteWeights(*sources, *targets) };
+	}
+
+	optional<vector<ReachableStop>> TransportRouter::CalculateReachable(string_view from, double max_time) const{
+		if (!search_spaces_){
+			throw logic_error("Graph is not built");
+		}
+		const auto from_vertex = vertexes_wait_.find(from);
+		if (from_vertex == vertexes_wait_.end()){
+			return nullopt;
+		}
+		vector<ReachableStop> stops;
+		const auto lease = search_spaces_->Acquire();
+		for (const auto& [vertex, weight] : graph::FindReachable(dw_graph_, *lease, from_vertex->second, max_time)){
+			if (wait_vertex_stops_[vertex]){
+				stops.push_back({ *wait_vertex_stops_[vertex], weight });
+			}
+		}
+		sort(stops.begin(), stops.end(), [](const ReachableStop& lhs, const ReachableStop& rhs){
+			return make_pair(lhs.time, lhs.stop_name) < make_pair(rhs.time, rhs.stop_name);
+		});
+		return stops;
+	}
+
+	void WriteTravelTimes(const TravelTimes& travel_times, ostream& output){
+		const char magic[8] = { 'T', 'C', 'T', 'I', 'M', 'E', 'S', '\n' };
+		const uint64_t sizes[2] = { travel_times.rows, travel_times.columns };
+		vector<double> times;
+		times.reserve(travel_times.times.size());
+		for (const auto& time : travel_times.times){
+			times.push_back(time.value_or(numeric_limits<double>::infinity()));
+		}
+		output.write(magic, sizeof(magic));
+		output.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+		output.write(reinterpret_cast<const char*>(times.data()), static_cast<streamsize>(times.size() * sizeof(double)));
+		if (!output){
+			throw runtime_error("Can't write the travel times");
+		}
+	}
+
+	void TransportRouter::Build(){
+		if (!IsGraphBuilt()){
+			BuildGraph();
+		}
+		if (!IsBuilt()){
+			BuildRouter();
+		}
+	}
+
+	bool TransportRouter::IsGraphBuilt() const{
+		return !vertexes_wait_.empty();
+	}
+
+	bool TransportRouter::IsBuilt() const{
+		return router_ != nullptr;
+	}
+
+	const graph::DirectedWeightedGraph<double>& TransportRouter::GetGraph() const{
+		return dw_graph_;
+	}
+
+	const graph::RouterBase<double>& TransportRouter::GetRouter() const{
+		if (!router_){
+			throw logic_error("Router is not built");
+		}
+		return *router_;
+	}
+
+	const VertexesMap& TransportRouter::GetWaitVertexes() const{
+		return vertexes_wait_;
+	}
+
+	const VertexesMap& TransportRouter::GetTravelVertexes() const{
+		return vertexes_travel_;
+	}
+
+	void TransportRouter::ApplyGraph(graph::DirectedWeightedGraph<double>&& dw_graph,
+		VertexesMap&& vertexes_wait, VertexesMap&& vertexes_travel){
+		router_.reset();
+		dw_graph_ = move(dw_graph);
+		vertexes_wait_ = move(vertexes_wait);
+		vertexes_travel_ = move(vertexes_travel);
+		IndexVertexes();
+	}
+
+	void TransportRouter::ApplyRoutesInternalData(RoutesStorage&& routes_internal_data){
+		router_ = make_unique<FloydWarshallRouter>(dw_graph_, move(routes_internal_data));
+	}
+
+	void TransportRouter::ApplyContractionHierarchy(graph::ContractionHierarchyRouter<double>::Hierarchy&& hierarchy){
+		router_ = make_unique<graph::ContractionHierarchyRouter<double>>(dw_graph_, move(hierarchy));
+	}
+
 	void TransportRouter::BuildGraph(){
+		// The router may be made before a base fills the catalogue.
+		dw_graph_ = graph::DirectedWeightedGraph<double>(tc_.GetAllStopsCount() * 2);
 		int vertex_id = 0;
+		vector<size_t> wait_vertexes(tc_.GetAllStopsCount());
 		for (const auto& stop : tc_.GetAllStopsPtr()){
+			wait_vertexes[stop->id] = vertex_id;
 			vertexes_wait_.insert({ stop->name, vertex_id });
 			vertexes_travel_.insert({ stop->name, ++vertex_id });
 			dw_graph_.AddEdge({
@@ -52,27 +216,97 @@ namespace router{
 				});
 			++vertex_id;
 		}
-		for (const auto& route : tc_.GetAllRoutesPtr()){
-			for (size_t it_from = 0; it_from < route->stops.size() - 1; ++it_from){
-				int span_count = 0;
-				for (size_t it_to = it_from + 1; it_to < route->stops.size(); ++it_to){
-					double road_distance = 0.0;
-					for (size_t it = it_from + 1; it <= it_to; ++it)
-					{
-						road_distance += static_cast<double>(tc_.GetDistance(route->stops[it - 1], route->stops[it]));
-					}
-					dw_graph_.AddEdge({
-							vertexes_travel_.at(route->stops[it_from]->name),
-							vertexes_wait_.at(route->stops[it_to]->name),
-							road_distance / (settings_.bus_velocity * METERS_IN_KILOMETR /  MINUTES_IN_HOUR),
-							route->route_name,
-							graph::EdgeType::TRAVEL,
-							++span_count
-						});
-				}
+		const deque<const transport_catalogue::Route*> routes = tc_.GetAllRoutesPtr();
+		vector<vector<graph::Edge<double>>> routes_edges(routes.size());
+		auto build_route_edges = [this, &routes, &routes_edges, &wait_vertexes](size_t route_index){
+			routes_edges[route_index] = BuildRouteEdges(*routes[route_index], wait_vertexes);
+		};
+		if (routes.size() > 1){
+			GetThreadPool().ParallelFor(routes.size(), build_route_edges);
+		}
+		else if (!routes.empty()){
+			build_route_edges(0);
+		}
+		for (const auto& route_edges : routes_edges){
+			for (const auto& edge : route_edges){
+				dw_graph_.AddEdge(edge);
+			}
+		}
+		IndexVertexes();
+	}
+
+	void TransportRouter::IndexVertexes(){
+		wait_vertex_stops_.assign(dw_graph_.GetVertexCount(), nullopt);
+		for (const auto& [stop_name, vertex] : vertexes_wait_){
+			wait_vertex_stops_.at(vertex) = stop_name;
+		}
+		search_spaces_ = make_unique<graph::SearchSpacePool<double>>(dw_graph_.GetVertexCount());
+		incoming_edges_ = graph::BuildIncomingEdges(dw_graph_);
+	}
+
+	RouteData TransportRouter::MakeRouteData(const vector<graph::EdgeId>& edges) const{
+		RouteData result;
+		result.founded = true;
+		for (const auto& element_id : edges){
+			const auto& edge_details = dw_graph_.GetEdge(element_id);
+			result.total_time += edge_details.weight;
+			result.items.emplace_back(RouteItem{
+				edge_details.edge_name,
+				(edge_details.type == graph::EdgeType::TRAVEL) ? edge_details.span_count : 0,
+				edge_details.weight,
+				edge_details.type });
+		}
+		return result;
+	}
+
+	vector<graph::Edge<double>> TransportRouter::BuildRouteEdges(const transport_catalogue::Route& route,
+		const vector<size_t>& wait_vertexes) const{
+		vector<graph::Edge<double>> route_edges;
+		const size_t stops_count = route.stops.size();
+		if (stops_count < 2){
+			return route_edges;
+		}
+		// The distance between stops i and j is a difference of two distances from the first stop.
+		const vector<size_t>& distances_from_start = route.distances_from_start;
+		const double meters_per_minute = settings_.bus_velocity * METERS_IN_KILOMETR / MINUTES_IN_HOUR;
+		route_edges.reserve(stops_count * (stops_count - 1) / 2);
+		for (size_t it_from = 0; it_from < stops_count - 1; ++it_from){
+			const size_t travel_vertex = wait_vertexes[route.stops[it_from]->id] + 1;
+			int span_count = 0;
+			for (size_t it_to = it_from + 1; it_to < stops_count; ++it_to){
+				const double road_distance = static_cast<double>(distances_from_start[it_to] - distances_from_start[it_from]);
+				route_edges.push_back({
+						travel_vertex,
+						wait_vertexes[route.stops[it_to]->id],
+						road_distance / meters_per_minute,
+						route.route_name,
+						graph::EdgeType::TRAVEL,
+						++span_count
+					});
 			}
 		}
-		router_ = make_unique<graph::Router<double>>(dw_graph_);
+		return route_edges;
+	}
+
+	void TransportRouter::BuildRouter(){
+		switch (settings_.router_engine){
+		case RouterEngine::FLOYD_WARSHALL:
+			router_ = make_unique<FloydWarshallRouter>(dw_graph_, &GetThreadPool());
+			break;
+		case RouterEngine::DIJKSTRA:
+			router_ = make_unique<graph::DijkstraRouter<double>>(dw_graph_);
+			break;
+		case RouterEngine::CONTRACTION_HIERARCHIES:
+			router_ = make_unique<graph::ContractionHierarchyRouter<double>>(dw_graph_);
+			break;
+		}
+	}
+
+	concurrency::ThreadPool& TransportRouter::GetThreadPool(){
+		if (!thread_pool_){
+			thread_pool_ = make_unique<concurrency::ThreadPool>();
+		}
+		return *thread_pool_;
 	}
 
-}
\ No newline at end of file
+}
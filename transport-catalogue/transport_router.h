@@ -3,17 +3,37 @@
 #include "domain.h"
 #include "transport_catalogue.h"
 #include "router.h"
+#include "dijkstra_router.h"
+#include "ch_router.h"
+#include "k_shortest_paths.h"
+#include "connection_scan.h"
+#include "thread_pool.h"
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string_view>
+#include <vector>
 
 
 namespace router{
 
+	enum class RouterEngine{
+		FLOYD_WARSHALL,
+		DIJKSTRA,
+		CONTRACTION_HIERARCHIES,
+	};
+
 	struct RouterSettings{
 		int bus_velocity = 40;
 		int bus_wait_time = 6;
+		RouterEngine router_engine = RouterEngine::FLOYD_WARSHALL;
 	};
 
 	struct RouteItem{
-		std::string edge_name;
+		// A name kept by the catalogue.
+		std::string_view edge_name;
 		int span_count = 0;
 		double time = 0.0;
 		graph::EdgeType type;
@@ -26,21 +46,90 @@ namespace router{
 	};
 
 
+	struct TravelTimes{
+		size_t rows = 0;
+		size_t columns = 0;
+		// Minutes from every source to every target, row by row; nullopt where there is no route.
+		std::vector<std::optional<double>> times;
+	};
+
+	struct ReachableStop{
+		// A name kept by the catalogue.
+		std::string_view stop_name;
+		double time = 0.0;
+	};
+
+	// Binary dump of the matrix: 8 bytes "TCTIMES\n", uint64_t rows and columns, then the times
+	// as doubles row by row, infinity where there is no route. Native byte order, as in the flat base.
+	void WriteTravelTimes(const TravelTimes&, std::ostream&);
+
+	// The most routes CalculateRoutes looks for: every one costs a few searches over the whole graph.
+	inline constexpr size_t MAX_ROUTE_ALTERNATIVES = 16;
+
+	using VertexesMap = std::unordered_map<std::string_view, size_t>;
+	using RoutesStorage = graph::FlatRoutesStorage<double>;
+	using FloydWarshallRouter = graph::Router<double, RoutesStorage>;
+
 class TransportRouter{
 	public:
 		TransportRouter(transport_catalogue::TransportCatalogue&);
 		void ApplyRouterSettings(RouterSettings&);
 		RouterSettings GetRouterSettings() const;
-		const RouteData CalculateRoute(const std::string_view, const std::string_view);
+		// Needs a built router; concurrent calls are safe.
+		const RouteData CalculateRoute(const std::string_view, const std::string_view) const;
+		// Up to count loopless routes in the order of their times, the best first; routes that differ
+		// only in the vertexes they pass are shown once. Needs a built graph; empty for an unknown stop.
+		// Throws invalid_argument if count is above MAX_ROUTE_ALTERNATIVES.
+		std::vector<RouteData> CalculateRoutes(std::string_view from, std::string_view to, size_t count) const;
+		// Total times only, computed for the whole matrix at once. Returns nullopt if a stop is unknown.
+		std::optional<TravelTimes> CalculateTravelTimes(const std::vector<std::string_view>& from,
+			const std::vector<std::string_view>& to) const;
+		// Stops that can be reached from the stop within max_time minutes, sorted by the time, found by
+		// a search on the graph that stops at the limit. Needs a built graph; nullopt for an unknown stop.
+		std::optional<std::vector<ReachableStop>> CalculateReachable(std::string_view from, double max_time) const;
+		// The route by the timetables of the buses that arrives first, leaving from not earlier than
+		// departure_time, in minutes after midnight. Waits are the real ones, total_time counts from
+		// departure_time. Not founded for an unknown stop. Concurrent calls are safe.
+		RouteData CalculateTimetableRoute(std::string_view from, std::string_view to, double departure_time) const;
 
-	private:
 		void BuildGraph();
+		void BuildRouter();
+		// Builds the graph and the router unless they are built (or read from a base) already.
+		void Build();
+		bool IsGraphBuilt() const;
+		bool IsBuilt() const;
+		const graph::DirectedWeightedGraph<double>& GetGraph() const;
+		const graph::RouterBase<double>& GetRouter() const;
+		const VertexesMap& GetWaitVertexes() const;
+		const VertexesMap& GetTravelVertexes() const;
+		void ApplyGraph(graph::DirectedWeightedGraph<double>&&, VertexesMap&&, VertexesMap&&);
+		void ApplyRoutesInternalData(RoutesStorage&&);
+		void ApplyContractionHierarchy(graph::ContractionHierarchyRouter<double>::Hierarchy&&);
+
+	private:
+		// Travel edges between every pair of stops of the route, in the order they enter the graph.
+		// wait_vertexes holds the wait vertex of every stop id, its travel vertex is the next one.
+		std::vector<graph::Edge<double>> BuildRouteEdges(const transport_catalogue::Route&, const std::vector<size_t>& wait_vertexes) const;
+		concurrency::ThreadPool& GetThreadPool();
+		// Prepares the per-vertex data of searches on the graph once the graph is built or applied.
+		void IndexVertexes();
+		RouteData MakeRouteData(const std::vector<graph::EdgeId>& edges) const;
+		const ConnectionScanRouter& GetTimetableRouter() const;
+
 		RouterSettings settings_;
 		transport_catalogue::TransportCatalogue& tc_;
 		graph::DirectedWeightedGraph<double> dw_graph_;
-		std::unique_ptr<graph::Router<double>> router_ = nullptr;
-		std::unordered_map<std::string_view, size_t> vertexes_wait_;
-		std::unordered_map<std::string_view, size_t> vertexes_travel_;
+		std::unique_ptr<graph::RouterBase<double>> router_ = nullptr;
+		VertexesMap vertexes_wait_;
+		VertexesMap vertexes_travel_;
+		std::unique_ptr<concurrency::ThreadPool> thread_pool_;
+		// The stop of every wait vertex, nullopt for travel vertexes.
+		std::vector<std::optional<std::string_view>> wait_vertex_stops_;
+		std::unique_ptr<graph::SearchSpacePool<double>> search_spaces_;
+		graph::IncomingEdges incoming_edges_;
+		// Built by the first timetable query, after the settings are applied.
+		mutable std::once_flag timetable_router_flag_;
+		mutable std::unique_ptr<ConnectionScanRouter> timetable_router_;
 	};
 
 }
\ No newline at end of file